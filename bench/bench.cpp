@@ -0,0 +1,111 @@
+// solver benchmark for PhysicsWorld, native or under node with emscripten.
+//
+//   sim_bench [threads] [simd:0|1]
+//
+// every (cloth size, solver, substeps) case builds a fresh world, warms it up
+// and then times a fixed number of step() calls, so two runs on the same
+// machine do the same work. energy drift is measured with global and spring
+// damping off, the floor constraint still takes energy out once the cloth
+// reaches it. cases whose energy goes non-finite print unstable instead
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "physics_world.hpp"
+
+namespace {
+
+struct Size {
+	int w, h;
+};
+
+constexpr Size SIZES[] = {{40, 30}, {200, 200}, {500, 500}};
+constexpr int SUB_STEPS[] = {1, 4, 8};
+constexpr const char *SOLVER_NAMES[] = {
+    "explicit_euler", "symplectic_euler", "verlet", "tc_verlet", "rk2",
+    "rk4",            "implicit_euler",   "velocity_verlet", "xpbd"};
+constexpr int SOLVER_COUNT = sizeof(SOLVER_NAMES) / sizeof(SOLVER_NAMES[0]);
+
+constexpr float DT = 1.0f / 60.0f;
+constexpr int WARMUP_STEPS = 2;
+// keeps the big cases from running for minutes, the step count only depends
+// on the case so it is the same on every run
+constexpr double WORK_PER_CASE = 4e6;
+
+struct Result {
+	double ns_per_particle_substep;
+	double springs_per_sec;
+	double drift;
+	int steps;
+};
+
+Result run_case(Size size, int solver, int sub_steps, int threads, bool simd) {
+	PhysicsWorld world;
+	world.set_thread_count(threads);
+	world.set_use_simd(simd);
+	world.create_cloth(-400, -200, 0, size.w, size.h, 20, 1200, 0);
+	world.set_gravity(0, 981, 0);
+	world.set_damping(1.0f);
+	world.set_mass(1.0f);
+	world.set_sub_steps(sub_steps);
+	world.set_solver(solver);
+
+	const double particles = world.get_p_count();
+	const double springs = world.get_s_count();
+	const int steps = std::clamp(
+	    static_cast<int>(WORK_PER_CASE / (particles * sub_steps)), 3, 240);
+
+	for (int i = 0; i < WARMUP_STEPS; ++i)
+		world.step(DT);
+
+	const double e0 = world.energy();
+	const auto t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < steps; ++i)
+		world.step(DT);
+	const auto t1 = std::chrono::steady_clock::now();
+	const double e1 = world.energy();
+
+	const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+	const double substeps = static_cast<double>(steps) * sub_steps;
+	Result r;
+	r.ns_per_particle_substep = ns / (substeps * particles);
+	r.springs_per_sec = springs * substeps / (ns * 1e-9);
+	r.drift = (e1 - e0) / std::max(1.0, std::fabs(e0));
+	r.steps = steps;
+	return r;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	const int threads = argc > 1 ? std::max(1, std::atoi(argv[1])) : 1;
+	const bool simd = argc > 2 ? std::atoi(argv[2]) != 0 : true;
+
+	PhysicsWorld probe;
+	std::printf("# threads %d, simd %s\n", threads,
+	            probe.has_simd() ? (simd ? "on" : "off") : "not built");
+	std::printf("%-9s %-17s %4s %6s %14s %14s %12s\n", "cloth", "solver", "sub",
+	            "steps", "ns/p/substep", "springs/s", "drift");
+
+	for (Size size : SIZES) {
+		for (int solver = 0; solver < SOLVER_COUNT; ++solver) {
+			for (int sub : SUB_STEPS) {
+				Result r = run_case(size, solver, sub, threads, simd);
+				char cloth[16];
+				std::snprintf(cloth, sizeof(cloth), "%dx%d", size.w, size.h);
+				// a case that blew up has no drift to report
+				char drift[16] = "unstable";
+				if (std::isfinite(r.drift))
+					std::snprintf(drift, sizeof(drift), "%.4g", r.drift);
+				std::printf("%-9s %-17s %4d %6d %14.2f %14.4g %12s\n", cloth,
+				            SOLVER_NAMES[solver], sub, r.steps,
+				            r.ns_per_particle_substep, r.springs_per_sec, drift);
+				std::fflush(stdout);
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "physics_world.hpp"
+
+// one create_cloth grid at several resolutions, for cloth that is far away
+// or off screen. level l has about every 2^l-th row and column spread over
+// the same sheet: the cells stretch to keep its size on each axis and the
+// particle mass grows with the cell area to keep its weight. a square spring
+// net with the same k is equally stiff at any spacing, so k stays too. only
+// the active level steps; switching resamples the active state into the new
+// level (see PhysicsWorld::resample_from). levels stop before a side drops
+// under MIN_SIDE particles.
+//
+// fine particle indices stay the interface: pins and positions set by index
+// go to the nearest particle of every level
+class ClothLod {
+public:
+	static constexpr int MAX_LEVELS = 4;
+	static constexpr int MIN_SIDE = 4;
+
+	void create_cloth(float sx, float sy, float sz, int w, int h, float sep,
+	                  float k, float damp) {
+		levels.clear();
+		active = 0;
+		fine_w = w;
+		fine_h = h;
+		for (int l = 0; l < MAX_LEVELS; ++l) {
+			const int lw = l == 0 ? w : ((w - 1) >> l) + 1;
+			const int lh = l == 0 ? h : ((h - 1) >> l) + 1;
+			if (l > 0 && (lw < MIN_SIDE || lh < MIN_SIDE))
+				break;
+			const float sep_x = lw > 1 ? sep * (w - 1) / (lw - 1) : sep;
+			const float sep_y = lh > 1 ? sep * (h - 1) / (lh - 1) : sep;
+			auto world = std::make_unique<PhysicsWorld>();
+			world->create_grid(sx, sy, sz, lw, lh, sep_x, sep_y, k, damp);
+			mass_scale[l] = sep_x * sep_y / (sep * sep);
+			levels.push_back(std::move(world));
+		}
+		set_mass(1.0f);
+	}
+
+	// the level being stepped
+	auto world() -> PhysicsWorld & {
+		return *levels[active];
+	}
+	auto world() const -> const PhysicsWorld & {
+		return *levels[active];
+	}
+	// f(PhysicsWorld &) on every level, for parameters that all of them share
+	template <class F> void for_levels(F &&f) {
+		for (auto &l : levels)
+			f(*l);
+	}
+
+	auto get_level_count() const -> int {
+		return levels.size();
+	}
+	auto get_level() const -> int {
+		return active;
+	}
+	void set_level(int level) {
+		level = std::clamp(level, 0, get_level_count() - 1);
+		if (level == active)
+			return;
+		levels[level]->resample_from(*levels[active]);
+		active = level;
+	}
+	// particles of level 0, what indices below refer to
+	auto get_p_count() const -> int {
+		return levels.empty() ? 0 : levels[0]->get_p_count();
+	}
+
+	// per particle mass of the finest level
+	void set_mass(float m) {
+		for (std::size_t l = 0; l < levels.size(); ++l)
+			levels[l]->set_mass(m * mass_scale[l]);
+	}
+	void set_pinned(int i, bool pin) {
+		for (int l = 0; l < get_level_count(); ++l) {
+			const int j = node(l, i);
+			if (j >= 0)
+				levels[l]->set_pinned(j, pin);
+		}
+	}
+	void set_particle_pos(int i, float x, float y, float z) {
+		for (int l = 0; l < get_level_count(); ++l) {
+			const int j = node(l, i);
+			if (j >= 0)
+				levels[l]->set_particle_pos(j, x, y, z);
+		}
+	}
+
+private:
+	std::vector<std::unique_ptr<PhysicsWorld>> levels;
+	float mass_scale[MAX_LEVELS] = {};
+	int active = 0;
+	int fine_w = 0, fine_h = 0;
+
+	// level l's particle nearest to fine particle i, -1 past the end
+	auto node(int l, int i) const -> int {
+		if (i < 0 || i >= fine_w * fine_h)
+			return -1;
+		const int lw = levels[l]->get_grid_w();
+		const int lh = levels[l]->get_grid_h();
+		if (lw == 0)
+			return l == 0 ? i : -1;
+		const float fx = fine_w > 1 ? float(lw - 1) / (fine_w - 1) : 0.0f;
+		const float fy = fine_h > 1 ? float(lh - 1) / (fine_h - 1) : 0.0f;
+		const int x = std::lround((i % fine_w) * fx);
+		const int y = std::lround((i / fine_w) * fy);
+		return y * lw + x;
+	}
+};
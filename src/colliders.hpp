@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+
+#include "vec3.hpp"
+
+// what an unfilled sdf cell holds. far outside but finite, so trilinear
+// blends with filled cells stay numbers (inf - inf would be nan)
+constexpr float SDF_EMPTY = FLT_MAX / 4;
+
+enum ColliderType {
+	COLLIDER_SPHERE = 0,
+	COLLIDER_CAPSULE = 1,
+	COLLIDER_PLANE = 2,
+	COLLIDER_SDF = 3
+};
+
+// packed collider record, three vec4 rows per collider so js can copy the
+// whole list into a gpu buffer as is. the layout matches Collider in
+// shaders.slang:
+//   0: type, radius, friction, restitution
+//   1: a.xyz, a.w
+//   2: b.xyz, b.w
+// sphere  a = centre
+// capsule a, b = segment ends
+// plane   a = unit normal, a.w = offset, outside is dot(n, x) >= offset
+// sdf     a = grid origin, a.w = cell size, b = dims, b.w = first value in
+//         the sdf pool. values are x fastest, negative inside
+// radius is the thickness around the shape, 0 for planes and sdfs unless set
+// directly
+constexpr std::size_t COLLIDER_STRIDE = 12;
+
+struct Aabb {
+	Vec3 lo, hi;
+
+	[[nodiscard]] bool overlaps(const Aabb &o) const {
+		return lo.x <= o.hi.x && o.lo.x <= hi.x && lo.y <= o.hi.y &&
+		       o.lo.y <= hi.y && lo.z <= o.hi.z && o.lo.z <= hi.z;
+	}
+};
+
+struct Contact {
+	Vec3 normal; // out of the collider
+	float depth; // how far to push along normal
+};
+
+struct Collider {
+	ColliderType type = COLLIDER_SPHERE;
+	Vec3 a{0, 0, 0};
+	Vec3 b{0, 0, 0};
+	float radius = 0.0f;
+	float offset = 0.0f; // plane offset, sdf cell size
+	int nx = 0, ny = 0, nz = 0;
+	std::size_t sdf_first = 0;
+	float friction = 0.0f;    // fraction of tangential velocity lost on contact
+	float restitution = 0.0f; // fraction of normal velocity bounced back
+
+	void pack(float *out) const {
+		const bool sdf = type == COLLIDER_SDF;
+		const Vec3 row2 = sdf ? Vec3{float(nx), float(ny), float(nz)} : b;
+		const float v[COLLIDER_STRIDE] = {
+			float(type), radius, friction, restitution,
+			a.x, a.y, a.z, offset,
+			row2.x, row2.y, row2.z, float(sdf_first),
+		};
+		std::copy(v, v + COLLIDER_STRIDE, out);
+	}
+
+	// planes are unbounded, callers test them with plane_clear instead
+	[[nodiscard]] Aabb bounds() const {
+		const Vec3 r{radius, radius, radius};
+		switch (type) {
+		case COLLIDER_SPHERE:
+			return {a - r, a + r};
+		case COLLIDER_CAPSULE:
+			return {Vec3{std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)} - r,
+			        Vec3{std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)} + r};
+		case COLLIDER_SDF:
+			return {a - r, a + Vec3{float(nx - 1), float(ny - 1), float(nz - 1)} * offset + r};
+		default:
+			return {Vec3{-INFINITY, -INFINITY, -INFINITY}, Vec3{INFINITY, INFINITY, INFINITY}};
+		}
+	}
+
+	// true when the whole box is farther than radius outside the plane
+	[[nodiscard]] bool plane_clear(const Aabb &box) const {
+		const Vec3 nearest{a.x >= 0 ? box.lo.x : box.hi.x, a.y >= 0 ? box.lo.y : box.hi.y,
+		                   a.z >= 0 ? box.lo.z : box.hi.z};
+		return a.dot(nearest) - offset >= radius;
+	}
+
+	// sdf is the start of the sdf pool, only read for COLLIDER_SDF
+	bool collide(Vec3 p, const float *sdf, Contact &c) const {
+		switch (type) {
+		case COLLIDER_SPHERE:
+			return push_out(p - a, c);
+		case COLLIDER_CAPSULE: {
+			const Vec3 ab = b - a;
+			const float len_sq = ab.dot(ab);
+			const float t = len_sq > 0.0f ? std::clamp((p - a).dot(ab) / len_sq, 0.0f, 1.0f) : 0.0f;
+			return push_out(p - (a + ab * t), c);
+		}
+		case COLLIDER_PLANE: {
+			const float d = a.dot(p) - offset;
+			if (d >= radius)
+				return false;
+			c = {a, radius - d};
+			return true;
+		}
+		case COLLIDER_SDF:
+			return collide_sdf(p, sdf + sdf_first, c);
+		}
+		return false;
+	}
+
+private:
+	bool push_out(Vec3 rel, Contact &c) const {
+		const float d_sq = rel.dot(rel);
+		if (d_sq >= radius * radius)
+			return false;
+		const float d = std::sqrt(d_sq);
+		// dead centre, any direction will do
+		c.normal = d > 1e-6f ? rel * (1.0f / d) : Vec3{0, -1, 0};
+		c.depth = radius - d;
+		return true;
+	}
+
+	[[nodiscard]] float at(const float *v, int x, int y, int z) const {
+		return v[(static_cast<std::size_t>(z) * ny + y) * nx + x];
+	}
+
+	// trilinear, p in cell units and inside the grid
+	[[nodiscard]] float sample(const float *v, Vec3 g) const {
+		const int x = std::min(int(g.x), nx - 2);
+		const int y = std::min(int(g.y), ny - 2);
+		const int z = std::min(int(g.z), nz - 2);
+		const float fx = g.x - x, fy = g.y - y, fz = g.z - z;
+		auto lerp = [](float l, float r, float t) { return l + (r - l) * t; };
+		const float c00 = lerp(at(v, x, y, z), at(v, x + 1, y, z), fx);
+		const float c10 = lerp(at(v, x, y + 1, z), at(v, x + 1, y + 1, z), fx);
+		const float c01 = lerp(at(v, x, y, z + 1), at(v, x + 1, y, z + 1), fx);
+		const float c11 = lerp(at(v, x, y + 1, z + 1), at(v, x + 1, y + 1, z + 1), fx);
+		return lerp(lerp(c00, c10, fy), lerp(c01, c11, fy), fz);
+	}
+
+	bool collide_sdf(Vec3 p, const float *v, Contact &c) const {
+		if (nx < 2 || ny < 2 || nz < 2 || offset <= 0.0f)
+			return false;
+		const Vec3 g = (p - a) * (1.0f / offset);
+		const Vec3 hi{float(nx - 1), float(ny - 1), float(nz - 1)};
+		// written so a nan position fails it too
+		if (!(g.x >= 0 && g.y >= 0 && g.z >= 0 && g.x <= hi.x && g.y <= hi.y && g.z <= hi.z))
+			return false;
+		const float d = sample(v, g);
+		if (!std::isfinite(d) || d >= radius)
+			return false;
+
+		// central differences, half a cell each way and clamped to the grid
+		auto probe = [&](Vec3 q) {
+			return sample(v, Vec3{std::clamp(q.x, 0.0f, hi.x), std::clamp(q.y, 0.0f, hi.y),
+			                      std::clamp(q.z, 0.0f, hi.z)});
+		};
+		const float h = 0.5f;
+		Vec3 grad{probe(g + Vec3{h, 0, 0}) - probe(g - Vec3{h, 0, 0}),
+		          probe(g + Vec3{0, h, 0}) - probe(g - Vec3{0, h, 0}),
+		          probe(g + Vec3{0, 0, h}) - probe(g - Vec3{0, 0, h})};
+		const float len = grad.length();
+		if (!std::isfinite(len) || len < 1e-8f)
+			return false;
+		c = {grad * (1.0f / len), radius - d};
+		return true;
+	}
+};
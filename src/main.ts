@@ -5,13 +5,21 @@ import WebGPU from 'three/addons/capabilities/WebGPU.js';
 import { OrbitControls } from 'three/addons/controls/OrbitControls.js';
 import { HDRLoader } from 'three/addons/loaders/HDRLoader.js';
 import { 
+  MeshPhysicalNodeMaterial,
   MeshStandardNodeMaterial, 
   StorageInstancedBufferAttribute, 
   WebGPURenderer 
 } from 'three/webgpu';
 import * as TSL from 'three/tsl';
+import { ReadbackRing } from './readback.js';
+import { GpuProfiler, readWasmStats, StatsPanel, type SimStats } from './stats.js';
 import type { SimModule } from './sim.js';
 
+// one module shared by every sim. each instance pre-spawns its own pthread
+// pool on a fresh heap (PTHREAD_POOL_SIZE) and nothing ever terminates
+// those, so switching sims must not create another one
+const simModule: Promise<SimModule> = createSimModule();
+
 // trying to move common functions(&others) out such as orbitcontrols wip
 
 const canvas = document.getElementById('webgpu-canvas') as HTMLCanvasElement;
@@ -63,17 +71,40 @@ guiSwitch.domElement.style.cssText = 'position:absolute;top:15px;left:15px;';
 
 let guiSim: GUI|null = null;
 let currentSim: SimInstance|null = null;
+let statsPanel: StatsPanel|null = null;
+// the wasm world as it was when it got switched away from, so switching back
+// resumes it instead of starting the cloth over
+let wasmResume: {state: Uint8Array, params: object, adaptive: object}|null =
+    null;
 
 enum mode {
   wasm = 0,
-  compute = 1
+  compute = 1,
+  hosted = 2,
+  batch = 3
 }
 const global_params = {
   mode: mode.wasm
 }
 
+// state copied back from the gpu path every few frames, see ReadbackRing
+type SimReadback = {
+  frame: number;
+  positions: Float32Array;  // xyzw of the selected range
+  bboxMin: [number, number, number];
+  bboxMax: [number, number, number];
+  kineticEnergy: number;
+  // fastest relative speed along a spring over its rest length, 1/s
+  strainRate: number;
+  picked: number;  // -1 when nothing is grabbed
+};
+
 type SimInstance = {
   update: (dt: number) => void; dispose: () => void;
+  // returns the unsubscribe function, only the compute path provides it
+  onReadback?: (cb: (r: SimReadback) => void) => () => void;
+  // per phase timings for the profiler panel, when the sim has them
+  getStats?: () => SimStats;
 }
 
 type SimFactory = (scene: THREE.Scene, renderer: WebGPURenderer, gui: GUI) =>
@@ -83,7 +114,7 @@ type SimFactory = (scene: THREE.Scene, renderer: WebGPURenderer, gui: GUI) =>
 const createComputeSim: SimFactory = async (scene, renderer, gui) => {
   const {default: shaders} = await import('./shaders.slang');
 
-  const backing = new ArrayBuffer(128);
+  const backing = new ArrayBuffer(160);
   const f32 = new Float32Array(backing);
   const u32 = new Uint32Array(backing);
   const i32 = new Int32Array(backing);
@@ -110,11 +141,19 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
     global_damping: 20,
     scount: 21,
     acount: 22,
-    useTicks: 23,
+    gridWidth: 23,
     rayo: 24,
     isdown: 27,
     rayd: 28,
-    _pad: 31
+    gridHeight: 31,
+    cellSize: 32,
+    hashSize: 33,
+    collisionRadius: 34,
+    selfCollision: 35,
+    activeList: 36,
+    sleepEnergy: 37,
+    sleepSteps: 38,
+    wakeColliders: 39
   };
 
   f32[pIdx.timeScale] = 1.0;
@@ -140,22 +179,16 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
   const SPACING = 2.0;
 
   u32[pIdx.count] = COUNT;
+  u32[pIdx.gridWidth] = GRID_W;
+  u32[pIdx.gridHeight] = GRID_H;
 
-  async function readPositions(
-      device: GPUDevice, gpuBuffer: GPUBuffer, count: number) {
-    const size = Math.min(count, 8) * 16;
-    const readBuf = device.createBuffer(
-        {size, usage: GPUBufferUsage.COPY_DST | GPUBufferUsage.MAP_READ});
-    const cmd = device.createCommandEncoder();
-    cmd.copyBufferToBuffer(gpuBuffer, 0, readBuf, 0, size);
-    device.queue.submit([cmd.finish()]);
-    await readBuf.mapAsync(GPUMapMode.READ);
-    const data = new Float32Array(readBuf.getMappedRange().slice());
-    readBuf.unmap();
-    console.log('first positions:', data);
-  }
-
-
+  // self collision through the spatial hash passes, see self_collide. the
+  // table has to be a power of two no larger than HASH_MAX in the shader
+  const HASH_MAX = 65536;
+  f32[pIdx.cellSize] = 0.0;  // 0: twice the contact distance
+  u32[pIdx.hashSize] = Math.min(HASH_MAX, 1 << Math.ceil(Math.log2(2 * COUNT)));
+  f32[pIdx.collisionRadius] = 0.8;
+  u32[pIdx.selfCollision] = 0;
 
   const folderSolver = gui.addFolder('Solver Engine');
 
@@ -168,11 +201,44 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
         'RK2 (Midpoint)': 4,
         'RK4 (Runge-Kutta)': 5,
         'Implicit Euler (Damped)': 6,
-        'Velocity Verlet': 7
+        'Velocity Verlet': 7,
+        'XPBD (Jacobi)': 8
       })
       .name('solver')
       .onChange((v: number) => u32[pIdx.solver] = v);
 
+  // jacobi passes per substep for the xpbd solver, only a dispatch count so it
+  // stays out of SimParams
+  const xpbd = {iterations: 2};
+  folderSolver.add(xpbd, 'iterations', 1, 16, 1).name('XPBD iterations');
+
+  // force pass staged through 16x16 groupshared tiles for regular grids, the
+  // general version walks the csr rows through global memory
+  const forces = {tiled: false};
+
+  // solver passes run indirectly over the particles that still move, see
+  // active_compact
+  const culling = {enabled: true};
+  folderSolver.add(culling, 'enabled')
+      .name('skip pinned particles')
+      .onChange(() => applySleep());
+
+  const folderCollision = gui.addFolder('Self Collision');
+  folderCollision.add({on: false}, 'on')
+      .name('enabled')
+      .onChange((v: boolean) => u32[pIdx.selfCollision] = v ? 1 : 0);
+  folderCollision
+      .add({r: f32[pIdx.collisionRadius]}, 'r', 0.1, 2.0, 0.05)
+      .name('radius')
+      .onChange((v: number) => f32[pIdx.collisionRadius] = v);
+  folderCollision.add({c: 0}, 'c', 0, 16, 0.5)
+      .name('cell size (0 auto)')
+      .onChange((v: number) => f32[pIdx.cellSize] = v);
+  folderCollision
+      .add({t: u32[pIdx.hashSize]}, 't', [4096, 8192, 16384, 32768, 65536])
+      .name('hash buckets')
+      .onChange((v: number) => u32[pIdx.hashSize] = v);
+
 
   new HDRLoader()
       .setPath('https://dl.polyhaven.org/file/ph-assets/HDRIs/hdr/1k/')
@@ -187,8 +253,8 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
       renderer.backend as unknown as {device: GPUDevice, get: (o: any) => any};
   const device = backend.device;
 
+  // xyz + pin flag in w, see the state layout at the top of shaders.slang
   const initialPos = new Float32Array(COUNT * 4);
-  const initialPin = new Float32Array(COUNT);
 
   for (let y = 0; y < GRID_H; y++) {
     for (let x = 0; x < GRID_W; x++) {
@@ -196,9 +262,7 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
       initialPos[i * 4 + 0] = (x - GRID_W / 2) * SPACING;
       initialPos[i * 4 + 1] = (GRID_H - y) * SPACING;
       initialPos[i * 4 + 2] = 0.0;
-      initialPos[i * 4 + 3] = 1.0;
-
-      if (y === 0) initialPin[i] = 1.0;
+      initialPos[i * 4 + 3] = y === 0 ? 1.0 : 0.0;
     }
   }
 
@@ -214,50 +278,122 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
 
 
 
-  // copy semantics wayyyyyyyyyyyy too slow, this was way too impractical
-
-  // const neighbors: {idx: number, dist: number, k: number, damp: number}[][] =
-  //     Array.from({length: COUNT}, () => []);
-
-  // function addLink(a: number, b: number, stiff: number) {
-  //   const dx = initialPos[a * 3] - initialPos[b * 3];
-  //   const dy = initialPos[a * 3 + 1] - initialPos[b * 3 + 1];
-  //   const dz = initialPos[a * 3 + 2] - initialPos[b * 3 + 2];
-  //   const dist = Math.sqrt(dx * dx + dy * dy + dz * dz);
-
-  //   neighbors[a].push({idx: b, dist, k: stiff, damp: 0.5});
-  //   neighbors[b].push({idx: a, dist, k: stiff, damp: 0.5});
-  // }
-
-  // for (let y = 0; y < GRID_H; y++) {
-  //   for (let x = 0; x < GRID_W; x++) {
-  //     const i = y * GRID_W + x;
-
-  //     if (x < GRID_W - 1) addLink(i, i + 1, 1.0);
-  //     if (y < GRID_H - 1) addLink(i, i + GRID_W, 1.0);
-  //     if (x < GRID_W - 1 && y < GRID_H - 1) addLink(i, i + GRID_W + 1, 0.5);
-  //     if (x > 0 && y < GRID_H - 1) addLink(i, i + GRID_W - 1, 0.5);
-  //   }
-  // }
-
-  // const totalLinks = neighbors.reduce((acc, list) => acc + list.length, 0);
-  // const adjOffsets = new Uint32Array(COUNT + 1);
-  // const adjIndices = new Uint32Array(totalLinks);
-  // const adjData = new Float32Array(totalLinks * 4);
-
-  // let offset = 0;
-  // for (let i = 0; i < COUNT; i++) {
-  //   adjOffsets[i] = offset;
-  //   for (const n of neighbors[i]) {
-  //     adjIndices[offset] = n.idx;
-  //     adjData[offset * 4 + 0] = n.dist;
-  //     adjData[offset * 4 + 1] = n.k;
-  //     adjData[offset * 4 + 2] = n.damp;
-  //     adjData[offset * 4 + 3] = 0;
-  //     offset++;
-  //   }
-  // }
-  // adjOffsets[COUNT] = offset;
+  // building the csr in js was way too slow, the topology comes from the same
+  // PhysicsWorld builder the wasm path uses and only its csr is kept. the
+  // builder's own positions and pins are ignored, csr is index based. it
+  // stays alive afterwards to hold the collider list, in gpu space (y up)
+  const wasm = await simModule;
+  const builder = new wasm.PhysicsWorld();
+  // tear thresholds are baked into the edges at upload, the toggle only
+  // decides whether the tearing passes run
+  const tear = {enabled: false, strain: 0.6, jitter: 0.3};
+  const topology = (() => {
+    builder.createCloth(
+        0, 0, 0, GRID_W, GRID_H, SPACING, f32[pIdx.stiffness],
+        f32[pIdx.damping]);
+    builder.setTearStrain(tear.strain, tear.jitter);
+    const heap = wasm.HEAP32.buffer;
+    const entries = builder.getAdjCount();
+    // slice() copies out of the (shared) heap into plain arrays
+    const offsets =
+        new Uint32Array(heap, builder.getAdjOffsetsPtr(), COUNT + 1).slice();
+    const indices =
+        new Uint32Array(heap, builder.getAdjIndicesPtr(), entries).slice();
+    const data =
+        new Float32Array(heap, builder.getAdjDataPtr(), entries * 4).slice();
+    return {offsets, indices, data};
+  })();
+
+  // truncating f32 -> f16 bits, small values flush to 0
+  const halfScratch = new Float32Array(1);
+  const halfBits = new Uint32Array(halfScratch.buffer);
+  const toHalf = (v: number) => {
+    halfScratch[0] = v;
+    const x = halfBits[0];
+    const sign = (x >>> 16) & 0x8000;
+    const exp = ((x >>> 23) & 0xff) - 112;
+    if (exp <= 0) return sign;
+    if (exp >= 31) return sign | 0x7c00;
+    return sign | (exp << 10) | ((x & 0x7fffff) >>> 13);
+  };
+  // adj_edges in shaders.slang: rest, k, damp | tear as fp16, neighbour
+  const packedEdges = (() => {
+    const {indices, data} = topology;
+    const edges = new Uint32Array(indices.length * 4);
+    const bits = new Uint32Array(data.buffer);
+    for (let e = 0; e < indices.length; e++) {
+      edges[e * 4 + 0] = bits[e * 4 + 0];
+      edges[e * 4 + 1] = bits[e * 4 + 1];
+      edges[e * 4 + 2] = toHalf(data[e * 4 + 2]) | (toHalf(data[e * 4 + 3]) << 16);
+      edges[e * 4 + 3] = indices[e];
+    }
+    return edges;
+  })();
+
+  // the floor used to be hard-coded at y = -100 with a half bounce and 10%
+  // tangential loss. the sphere is the last collider so leaving it out is
+  // just a shorter count
+  builder.clearColliders();
+  const floorId = builder.addPlane(0, 1, 0, -100);
+  builder.setColliderMaterial(floorId, 0.1, 0.5);
+  const sphere = {enabled: false, z: 60, radius: 60};
+  const sphereY = GRID_H * SPACING * 0.5;
+  const sphereId = builder.addSphere(0, sphereY, sphere.z, sphere.radius);
+  builder.setColliderMaterial(sphereId, 0.2, 0.0);
+
+  const folderTear = gui.addFolder('Tearing');
+  folderTear.add(tear, 'enabled').name('enabled');
+  folderTear
+      .add(
+          {
+            repair: () => {
+              device.queue.writeBuffer(bufAdjOffsets, 0, topology.offsets);
+              device.queue.writeBuffer(bufAdjEdges, 0, packedEdges);
+            }
+          },
+          'repair')
+      .name('repair springs');
+
+  const folderColliders = gui.addFolder('Colliders');
+  folderColliders.add(sphere, 'enabled').name('sphere');
+  folderColliders.add(sphere, 'z', -200, 200)
+      .name('sphere z')
+      .onChange((v: number) => builder.setColliderPos(sphereId, 0, sphereY, v));
+
+  // the tiled force pass hard-codes the cloth stencil: 8 neighbours, rest
+  // SPACING or SPACING * sqrt2 and the global stiffness/damping. only use it
+  // if the csr is exactly that
+  const isRegularGrid = () => {
+    const {offsets, indices, data} = topology;
+    for (let i = 0; i < COUNT; i++) {
+      const x = i % GRID_W, y = Math.floor(i / GRID_W);
+      let expected = 0;
+      for (let dy = -1; dy <= 1; dy++) {
+        for (let dx = -1; dx <= 1; dx++) {
+          const nx = x + dx, ny = y + dy;
+          if ((dx || dy) && nx >= 0 && nx < GRID_W && ny >= 0 && ny < GRID_H)
+            expected++;
+        }
+      }
+      if (offsets[i + 1] - offsets[i] !== expected) return false;
+      for (let e = offsets[i]; e < offsets[i + 1]; e++) {
+        const j = indices[e];
+        const dx = (j % GRID_W) - x, dy = Math.floor(j / GRID_W) - y;
+        if (Math.abs(dx) > 1 || Math.abs(dy) > 1) return false;
+        const rest = dx && dy ? SPACING * Math.SQRT2 : SPACING;
+        if (Math.abs(data[e * 4] - rest) > 1e-4 ||
+            data[e * 4 + 1] !== f32[pIdx.stiffness] ||
+            data[e * 4 + 2] !== f32[pIdx.damping])
+          return false;
+      }
+    }
+    return true;
+  };
+  const regularGrid = isRegularGrid();
+  forces.tiled = regularGrid;
+  if (regularGrid) {
+    folderSolver.add(forces, 'tiled').name('Tiled grid fast path');
+  }
 
 
 
@@ -313,37 +449,236 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
   particleMesh.frustumCulled = false;
   scene.add(particleMesh);
 
+  const sphereMesh = new THREE.Mesh(
+      new THREE.SphereGeometry(sphere.radius * 0.97, 32, 16),
+      new MeshStandardNodeMaterial({color: 0x4477aa, roughness: 0.6}));
+  sphereMesh.position.set(0, sphereY, sphere.z);
+  scene.add(sphereMesh);
+
 
   const uniformBuffer =
       createBuf(backing, GPUBufferUsage.UNIFORM | GPUBufferUsage.COPY_DST);
+  // Motion in shaders.slang: fp16 velocity, fp32 acceleration, 20 bytes
   const motionBuffer = createBuf(
-      new Float32Array(COUNT * 3 * 4),
+      new Uint32Array(COUNT * 5),
       GPUBufferUsage.STORAGE | GPUBufferUsage.COPY_DST);
-  const pinBuffer =
-      createBuf(initialPin, GPUBufferUsage.STORAGE | GPUBufferUsage.COPY_DST);
   // const prevDtBuffer = createBuf(new Float32Array(COUNT));
-  // const bufAdjOffsets = createBuf(adjOffsets);
-  // const bufAdjIndices = createBuf(adjIndices);
-  // const bufAdjData = createBuf(adjData);
+  // (grab distance bits, grabbed index), see pick in shaders.slang
+  const PICK_RESET = new Uint32Array([0x7f800000, 0xffffffff]);
+  // words 2..11: box min and max as order preserving uints, kinetic energy,
+  // see frame_stats. reset before every frame that collects them
+  const STATS_RESET = new Uint32Array([
+    0xff800000, 0xff800000, 0xff800000, 0x007fffff, 0x007fffff, 0x007fffff,
+    0, 0, 0, 0
+  ]);
+  const pickBuffer = createBuf(
+      new Uint32Array(12),
+      GPUBufferUsage.STORAGE | GPUBufferUsage.COPY_DST |
+          GPUBufferUsage.COPY_SRC);
+  device.queue.writeBuffer(pickBuffer, 0, PICK_RESET);
+  let pickPending = false;
+  // bucket starts, then per particle bucket / rank / sorted index, the scan
+  // block sums, then the active list's indirect args and indices, see
+  // hash_data in shaders.slang
+  const ACTIVE_ARGS_OFFSET = (HASH_MAX + 1 + 3 * COUNT + 256) * 4;
+  const ACTIVE_RESET = new Uint32Array([0, 1, 1, 0]);
+  // (energy, still frames) per 8x8 tile, see sleep_measure
+  const SLEEP_TILE = 8;
+  const sleepGroups: [number, number] =
+      [Math.ceil(GRID_W / SLEEP_TILE), Math.ceil(GRID_H / SLEEP_TILE)];
+  const SLEEP_OFFSET = ACTIVE_ARGS_OFFSET + (4 + COUNT) * 4;
+  const SLEEP_RESET = new Uint32Array(2 * sleepGroups[0] * sleepGroups[1]);
+  const hashBuffer = createBuf(
+      new Uint32Array(
+          HASH_MAX + 1 + 3 * COUNT + 256 + 4 + COUNT + SLEEP_RESET.length),
+      GPUBufferUsage.STORAGE | GPUBufferUsage.COPY_SRC |
+          GPUBufferUsage.COPY_DST | GPUBufferUsage.INDIRECT);
+
+  // ColliderSet in shaders.slang: a uint4 header then the packed records
+  const MAX_COLLIDERS = 32;
+  const colliderData = new Float32Array(4 + MAX_COLLIDERS * wasm.COLLIDER_STRIDE);
+  const colliderBuffer = createBuf(
+      colliderData, GPUBufferUsage.UNIFORM | GPUBufferUsage.COPY_DST);
+  // sdf grids stacked along z, built once since the values don't change
+  // after setup. record b.w becomes the first slice instead of the pool index
+  const sdfSlices: number[] = [];
+  const sdfAtlas = (() => {
+    const records = new Float32Array(
+        wasm.HEAPF32.buffer, builder.getColliderPtr(),
+        builder.getColliderCount() * wasm.COLLIDER_STRIDE);
+    const grids = [];
+    let w = 1, h = 1, d = 0;
+    for (let k = 0; k < builder.getColliderCount(); k++) {
+      const r = k * wasm.COLLIDER_STRIDE;
+      sdfSlices.push(d);
+      if (records[r] !== 3) continue;
+      const [nx, ny, nz, first] = records.slice(r + 8, r + 12);
+      grids.push({nx, ny, nz, first, z: d});
+      w = Math.max(w, nx);
+      h = Math.max(h, ny);
+      d += nz;
+    }
+    const tex = device.createTexture({
+      size: [w, h, Math.max(d, 1)],
+      dimension: '3d',
+      format: 'r32float',
+      usage: GPUTextureUsage.TEXTURE_BINDING | GPUTextureUsage.COPY_DST
+    });
+    destroyer.push(tex);
+    const pool = new Float32Array(
+        wasm.HEAPF32.buffer, builder.getSdfPoolPtr(), builder.getSdfPoolSize());
+    for (const g of grids) {
+      device.queue.writeTexture(
+          {texture: tex, origin: [0, 0, g.z]},
+          pool.slice(g.first, g.first + g.nx * g.ny * g.nz),
+          {bytesPerRow: g.nx * 4, rowsPerImage: g.ny}, [g.nx, g.ny, g.nz]);
+    }
+    return tex;
+  })();
+  const lastColliders = new Float32Array(colliderData.length);
+  let lastColliderCount = 0;
+  const uploadColliders = () => {
+    const all = builder.getColliderCount();
+    const count =
+        Math.min(MAX_COLLIDERS, sphere.enabled ? all : Math.min(all, sphereId));
+    const stride = wasm.COLLIDER_STRIDE;
+    // the heap view is made fresh, setColliderPos never reallocates but
+    // growth elsewhere can detach an old one
+    colliderData.set(
+        new Float32Array(
+            wasm.HEAPF32.buffer, builder.getColliderPtr(), count * stride),
+        4);
+    for (let k = 0; k < count; k++) {
+      if (colliderData[4 + k * stride] === 3)
+        colliderData[4 + k * stride + 11] = sdfSlices[k];
+    }
+    new Uint32Array(colliderData.buffer, 0, 4).set([count, 0, 0, 0]);
+    device.queue.writeBuffer(colliderBuffer, 0, colliderData);
+
+    // sleeping tiles a changed collider reaches wake up, a removed one
+    // wakes everything since the shader can't see where it was
+    let changed = count < lastColliderCount ? 0xffffffff : 0;
+    for (let k = 0; k < count && changed !== 0xffffffff; k++) {
+      for (let f = 4 + k * stride; f < 4 + (k + 1) * stride; f++) {
+        if (colliderData[f] !== lastColliders[f]) {
+          changed |= 1 << k;
+          break;
+        }
+      }
+    }
+    u32[pIdx.wakeColliders] = changed >>> 0;
+    lastColliders.set(colliderData);
+    lastColliderCount = count;
+  };
+  const bufAdjOffsets = createBuf(
+      topology.offsets, GPUBufferUsage.STORAGE | GPUBufferUsage.COPY_DST);
+  const bufAdjEdges = createBuf(
+      packedEdges, GPUBufferUsage.STORAGE | GPUBufferUsage.COPY_DST);
+  // tear_scatter's target, copied over bufAdjEdges after the tearing passes
+  const bufAdjEdgesNext = createBuf(
+      packedEdges, GPUBufferUsage.STORAGE | GPUBufferUsage.COPY_SRC);
 
 
   const shaderModule = device.createShaderModule({code: shaders.code});
-  const computePipeline = device.createComputePipeline(
-      {layout: 'auto', compute: {module: shaderModule, entryPoint: 'cxextra'}});
+
+  // one explicit layout for every entry point, 'auto' would give each pipeline
+  // its own layout and the bind groups couldn't be shared between them
+  const storageEntry =
+      (binding: number, type: GPUBufferBindingType = 'storage'):
+          GPUBindGroupLayoutEntry =>
+              ({binding, visibility: GPUShaderStage.COMPUTE, buffer: {type}});
+  const bindGroupLayout = device.createBindGroupLayout({
+    entries: [
+      {binding: 0, visibility: GPUShaderStage.COMPUTE, buffer: {type: 'uniform'}},
+      storageEntry(1),
+      storageEntry(2),
+      storageEntry(3),
+      storageEntry(5),
+      storageEntry(6, 'read-only-storage'),
+      storageEntry(7, 'read-only-storage'),
+      storageEntry(8),
+      storageEntry(9),
+      {binding: 10, visibility: GPUShaderStage.COMPUTE, buffer: {type: 'uniform'}},
+      {
+        binding: 11,
+        visibility: GPUShaderStage.COMPUTE,
+        texture: {sampleType: 'unfilterable-float', viewDimension: '3d'}
+      },
+    ]
+  });
+  const pipelineLayout =
+      device.createPipelineLayout({bindGroupLayouts: [bindGroupLayout]});
+  const createPipeline = (entryPoint: string) => device.createComputePipeline(
+      {layout: pipelineLayout, compute: {module: shaderModule, entryPoint}});
+
+  const forcesPipeline = createPipeline('accumulate_forces');
+  const forcesTiledPipeline = createPipeline('accumulate_forces_tiled');
+  // one per solver id, 6 (implicit euler on the cpu) is symplectic here
+  const integratePipelines = [
+    'integrate_explicit_euler_step', 'integrate_symplectic_euler_step',
+    'integrate_verlet_step', 'integrate_tc_verlet_step', 'integrate_rk2_step',
+    'integrate_rk4_step', 'integrate_symplectic_euler_step'
+  ].map(createPipeline);
+  const vvPass1 = createPipeline('vv_pass1');
+  const vvPass2 = createPipeline('vv_pass2');
+  const pickScore = createPipeline('pick_score');
+  const pickIndex = createPipeline('pick_index');
+  const xpbdPredict = createPipeline('xpbd_predict');
+  const xpbdProject = createPipeline('xpbd_project');
+  const xpbdFinalize = createPipeline('xpbd_finalize');
+  const hashClear = createPipeline('hash_clear');
+  const hashCount = createPipeline('hash_count');
+  const scanLocal = createPipeline('scan_local');
+  const scanBlocks = createPipeline('scan_blocks');
+  const scanAdd = createPipeline('scan_add');
+  const hashScatter = createPipeline('hash_scatter');
+  const selfCollide = createPipeline('self_collide');
+  const resolveColliders = createPipeline('resolve_colliders');
+  const frameStats = createPipeline('frame_stats');
+  const activeCompact = createPipeline('active_compact');
+  const activeArgs = createPipeline('active_args');
+  const sleepMeasure = createPipeline('sleep_measure');
+  const sleepDecide = createPipeline('sleep_decide');
+
+  // settled tiles drop out of the active list, so it needs the culling on.
+  // every change starts the tiles over awake
+  const sleeping = {enabled: false, energy: 0.01, frames: 60};
+  const applySleep = () => {
+    u32[pIdx.sleepSteps] =
+        sleeping.enabled && culling.enabled ? sleeping.frames : 0;
+    f32[pIdx.sleepEnergy] = sleeping.energy;
+    device.queue.writeBuffer(hashBuffer, SLEEP_OFFSET, SLEEP_RESET);
+  };
+  applySleep();
+  const folderSleep = gui.addFolder('Sleeping');
+  folderSleep.add(sleeping, 'enabled').onChange(applySleep);
+  folderSleep.add(sleeping, 'energy', 0.001, 1)
+      .name('energy threshold')
+      .onChange(applySleep);
+  folderSleep.add(sleeping, 'frames', 1, 240, 1)
+      .name('still frames')
+      .onChange(applySleep);
+  const tearCount = createPipeline('tear_count');
+  const topoScanLocal = createPipeline('topo_scan_local');
+  const topoScanBlocks = createPipeline('topo_scan_blocks');
+  const topoScanAdd = createPipeline('topo_scan_add');
+  const tearScatter = createPipeline('tear_scatter');
 
   const getBindGroup = (readBuf: GPUBuffer, writeBuf: GPUBuffer) => {
     return device.createBindGroup({
-      layout: computePipeline.getBindGroupLayout(0),
+      layout: bindGroupLayout,
       entries: [
         {binding: 0, resource: {buffer: uniformBuffer}},
         {binding: 1, resource: {buffer: readBuf}},
         {binding: 2, resource: {buffer: writeBuf}},
         {binding: 3, resource: {buffer: motionBuffer}},
-        {binding: 4, resource: {buffer: pinBuffer}},
-        // {binding: 5, resource: {buffer: prevDtBuffer}},
-        // {binding: 6, resource: {buffer: bufAdjOffsets}},
-        // {binding: 7, resource: {buffer: bufAdjIndices}},
-        // {binding: 8, resource: {buffer: bufAdjData}},
+        {binding: 5, resource: {buffer: pickBuffer}},
+        {binding: 6, resource: {buffer: bufAdjOffsets}},
+        {binding: 7, resource: {buffer: bufAdjEdges}},
+        {binding: 8, resource: {buffer: bufAdjEdgesNext}},
+        {binding: 9, resource: {buffer: hashBuffer}},
+        {binding: 10, resource: {buffer: colliderBuffer}},
+        {binding: 11, resource: sdfAtlas.createView()},
       ]
     });
   };
@@ -374,6 +709,10 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
   const onPointerDown = (e: PointerEvent) => {
     if (e.button !== 0) return;
     if (e.target instanceof HTMLElement && e.target.closest('.lil-gui')) return;
+    onPointerMove(e);
+    // the next update runs the pick passes against the current positions
+    device.queue.writeBuffer(pickBuffer, 0, PICK_RESET);
+    pickPending = true;
     f32[pIdx.isdown] = 1;
   };
 
@@ -392,7 +731,125 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
 
 
   let frame = 0;
+  let tick = 0;
+
+  // positions of [READBACK_FIRST, READBACK_FIRST + READBACK_COUNT) and the
+  // pick/stats words, every readback.interval frames
+  const READBACK_FIRST = 0;
+  const READBACK_COUNT = COUNT;
+  const currentPositions = () => frame % 2 === 0 ? posBufferA : posBufferB;
+  const readback = new ReadbackRing(device, [
+    {
+      source: currentPositions,
+      offset: READBACK_FIRST * 16,
+      size: READBACK_COUNT * 16
+    },
+    {source: () => pickBuffer, offset: 0, size: 48},
+  ]);
+  const unorderFloat = (u: number) =>
+      new Float32Array(new Uint32Array([u & 0x80000000 ? u & 0x7fffffff : ~u])
+                           .buffer)[0];
+  const onReadback = (cb: (r: SimReadback) => void) =>
+      readback.subscribe(({frame, regions}) => {
+        const words = new Uint32Array(regions[1]);
+        const box = Array.from(words.subarray(2, 8), unorderFloat);
+        const grabbed = f32[pIdx.isdown] > 0.5 && words[1] !== 0xffffffff;
+        cb({
+          frame,
+          positions: new Float32Array(regions[0]),
+          bboxMin: [box[0], box[1], box[2]],
+          bboxMax: [box[3], box[4], box[5]],
+          kineticEnergy: new Float32Array(words.buffer, 32, 1)[0],
+          strainRate: new Float32Array(words.buffer, 36, 1)[0],
+          picked: grabbed ? words[1] : -1
+        });
+      });
+
+  const telemetry = {kinetic: 0, height: 0, picked: -1};
+  const folderTelemetry = gui.addFolder('Telemetry');
+  folderTelemetry.add(readback, 'interval', 1, 60, 1).name('every n frames');
+  folderTelemetry.add(telemetry, 'kinetic').name('kinetic energy').listen()
+      .disable();
+  folderTelemetry.add(telemetry, 'height').name('cloth height').listen()
+      .disable();
+  folderTelemetry.add(telemetry, 'picked').name('grabbed particle').listen()
+      .disable();
+  // webgpu timestamps around the solver passes, the frames they time are
+  // split into a pass per phase so this costs a little while it's on
+  const GPU_PHASES = [
+    'upkeep', 'forces', 'springs', 'integrate', 'contacts', 'tear', 'stats'
+  ] as const;
+  const gpuPhase = (name: typeof GPU_PHASES[number]) =>
+      GPU_PHASES.indexOf(name);
+  const gpuProfiler = new GpuProfiler(device, GPU_PHASES);
+  const gpuCounters = {substeps: 0, dispatches: 0};
+  folderTelemetry.add(gpuProfiler, 'enabled')
+      .name(gpuProfiler.supported ? 'gpu timestamps' : 'gpu timestamps (n/a)')
+      .enable(gpuProfiler.supported);
+  folderTelemetry.add(gpuProfiler, 'interval', 1, 60, 1)
+      .name('time every n frames');
+  const getStats = () => {
+    const stats = gpuProfiler.stats();
+    Object.assign(stats.counters, gpuCounters);
+    return stats;
+  };
+  const stopTelemetry = onReadback(r => {
+    telemetry.kinetic = r.kineticEnergy;
+    telemetry.height = r.bboxMax[1] - r.bboxMin[1];
+    telemetry.picked = r.picked;
+  });
+
+  // substeps sized like PhysicsWorld::choose_sub_steps: the stiffest csr row
+  // bounds the spring frequency, the strain rate read back a few frames late
+  // bounds how far a spring may stretch per substep
+  const adaptive = {enabled: false, min: 1, max: 16, courant: 0.5};
+  const stiffness = (() => {
+    const {offsets, data} = topology;
+    let rowK = 0;
+    let rowD = 0;
+    for (let i = 0; i < COUNT; i++) {
+      let k = 0;
+      let d = 0;
+      for (let e = offsets[i]; e < offsets[i + 1]; e++) {
+        k += data[e * 4 + 1];
+        d += data[e * 4 + 2];
+      }
+      rowK = Math.max(rowK, k);
+      rowD = Math.max(rowD, d);
+    }
+    const mass = f32[pIdx.mass];
+    return {omega: Math.sqrt(rowK * 2 / mass), zeta: rowD * 2 / mass};
+  })();
+  let strainRate = 0;
+  const stopAdaptive = onReadback(r => strainRate = r.strainRate);
+  const folderAdaptive = folderSolver.addFolder('Adaptive Substeps');
+  const fixedSubSteps = u32[pIdx.subSteps];
+  folderAdaptive.add(adaptive, 'enabled')
+      .name('enabled')
+      .onChange((v: boolean) => {
+        if (!v) u32[pIdx.subSteps] = fixedSubSteps;
+      });
+  folderAdaptive.add(adaptive, 'min', 1, 16, 1).name('min substeps');
+  folderAdaptive.add(adaptive, 'max', 1, 64, 1).name('max substeps');
+  folderAdaptive.add(adaptive, 'courant', 0.1, 1.0, 0.05).name('courant');
+  const chooseSubSteps = () => {
+    const solver = u32[pIdx.solver];
+    // rk holds the neighbours at the substep start, implicit and xpbd don't
+    // blow up on stiffness, only the strain rate limits them
+    const limit = solver === 0 || solver === 4 || solver === 5 ? 0.7 :
+        solver === 6 || solver === 8                           ? Infinity :
+                                                                 2;
+    let h = Math.min(limit / stiffness.omega, limit / stiffness.zeta);
+    if (strainRate > 0) h = Math.min(h, 1 / strainRate);
+    h *= adaptive.courant;
+    const n = Number.isFinite(h) ? Math.ceil(f32[pIdx.simDt] / h) : 1;
+    return Math.min(
+        Math.max(n, adaptive.min), Math.max(adaptive.min, adaptive.max));
+  };
   const workgroupCount = Math.ceil(COUNT / 64);
+  const TILE = 16;  // accumulate_forces_tiled group size
+  const tileGroups: [number, number] =
+      [Math.ceil(GRID_W / TILE), Math.ceil(GRID_H / TILE)];
 
   const dispose = () => {
     dom.removeEventListener('pointerdown', onPointerDown, {capture: true});
@@ -405,25 +862,144 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
     particleMesh.geometry.dispose();
     if (particleMesh.material.map) particleMesh.material.map.dispose();
     particleMesh.material.dispose();
+    stopTelemetry();
+    stopAdaptive();
+    readback.dispose();
+    gpuProfiler.dispose();
+    scene.remove(sphereMesh);
+    sphereMesh.geometry.dispose();
+    sphereMesh.material.dispose();
+    builder.delete();
 
     destroyer.forEach(res => res.destroy());
   };
   const update = (dt: number) => {
+    uploadColliders();
+    u32[pIdx.activeList] = culling.enabled ? 1 : 0;
+    if (adaptive.enabled) u32[pIdx.subSteps] = chooseSubSteps();
     device.queue.writeBuffer(uniformBuffer, 0, backing);
+    if (culling.enabled)
+      device.queue.writeBuffer(hashBuffer, ACTIVE_ARGS_OFFSET, ACTIVE_RESET);
+    if (readback.due(tick))
+      device.queue.writeBuffer(pickBuffer, 8, STATS_RESET);
+    sphereMesh.visible = sphere.enabled;
+    sphereMesh.position.z = sphere.z;
     const steps = u32[pIdx.subSteps];
+    const solver = u32[pIdx.solver];
     const encoder = device.createCommandEncoder();
+    // all substeps go into one compute pass, webgpu orders the storage writes
+    // between dispatches. passes that write positions flip the ping-pong,
+    // forces and vv_pass2 only touch motions and keep the current buffers.
+    // frames the gpu profiler times get a pass per phase instead
+    const timeline = gpuProfiler.begin(encoder);
+    let pass = timeline.pass(gpuPhase('upkeep'));
+    const at = (name: typeof GPU_PHASES[number]) => {
+      pass = timeline.pass(gpuPhase(name));
+    };
+    gpuCounters.substeps = steps;
+    gpuCounters.dispatches = 0;
+    const dispatch =
+        (pipeline: GPUComputePipeline, flips = true,
+         groups: [number, number] = [workgroupCount, 1]) => {
+          const readA = frame % 2 === 0;
+          gpuCounters.dispatches++;
+          pass.setPipeline(pipeline);
+          pass.setBindGroup(0, readA ? bindGroupA : bindGroupB);
+          pass.dispatchWorkgroups(groups[0], groups[1]);
+          if (flips) frame++;
+        };
+    // the per particle solver passes, one thread per active particle
+    const dispatchActive = (pipeline: GPUComputePipeline, flips = true) => {
+      if (!culling.enabled) return dispatch(pipeline, flips);
+      gpuCounters.dispatches++;
+      pass.setPipeline(pipeline);
+      pass.setBindGroup(0, frame % 2 === 0 ? bindGroupA : bindGroupB);
+      pass.dispatchWorkgroupsIndirect(hashBuffer, ACTIVE_ARGS_OFFSET);
+      if (flips) frame++;
+    };
+    // the tiled stencil assumes every grid spring is still there
+    const dispatchForces = () => {
+      at('forces');
+      if (forces.tiled && !tear.enabled)
+        dispatch(forcesTiledPipeline, false, tileGroups);
+      else
+        dispatchActive(forcesPipeline, false);
+    };
+    const hashGroups: [number, number] = [u32[pIdx.hashSize] / 256, 1];
+    const dispatchContacts = () => {
+      at('contacts');
+      if (u32[pIdx.selfCollision]) {
+        dispatch(hashClear, false, hashGroups);
+        dispatch(hashCount, false);
+        dispatch(scanLocal, false, hashGroups);
+        dispatch(scanBlocks, false, [1, 1]);
+        dispatch(scanAdd, false, hashGroups);
+        dispatch(hashScatter, false);
+        dispatchActive(selfCollide);
+      }
+      dispatchActive(resolveColliders);
+    };
+    if (pickPending) {
+      dispatch(pickScore, false);
+      dispatch(pickIndex, false);
+      pickPending = false;
+    }
+    if (u32[pIdx.sleepSteps] > 0) {
+      dispatch(sleepMeasure, false, sleepGroups);
+      dispatch(sleepDecide, false, sleepGroups);
+    }
+    if (culling.enabled) {
+      dispatch(activeCompact, false);
+      dispatch(activeArgs, false, [1, 1]);
+    }
     for (let i = 0; i < steps; i++) {
-        const readA = frame % 2 === 0;
-        const currentBindGroup = readA ? bindGroupA : bindGroupB;
-        
-        const pass = encoder.beginComputePass();
-        pass.setPipeline(computePipeline);
-        pass.setBindGroup(0, currentBindGroup);
-        pass.dispatchWorkgroups(workgroupCount);
-        pass.end();
-
-
-        frame++;
+      if (solver === 8) {
+        at('integrate');
+        dispatchActive(xpbdPredict);
+        at('springs');
+        for (let it = 0; it < xpbd.iterations; it++)
+          dispatchActive(xpbdProject);
+        dispatchContacts();
+        at('integrate');
+        dispatchActive(xpbdFinalize);
+      } else if (solver === 7) {
+        at('integrate');
+        dispatchActive(vvPass1);
+        dispatchContacts();
+        dispatchForces();
+        at('integrate');
+        dispatchActive(vvPass2, false);
+      } else {
+        // rk sums its own forces, and the integrate pass already ran the
+        // colliders unless self collision has to come first
+        if (solver !== 4 && solver !== 5) dispatchForces();
+        at('integrate');
+        dispatchActive(integratePipelines[solver]);
+        if (u32[pIdx.selfCollision]) dispatchContacts();
+      }
+    }
+    if (tear.enabled) {
+      at('tear');
+      const rowGroups: [number, number] = [Math.ceil((COUNT + 1) / 64), 1];
+      const scanGroups: [number, number] = [Math.ceil((COUNT + 1) / 256), 1];
+      dispatch(tearCount, false, rowGroups);
+      dispatch(topoScanLocal, false, scanGroups);
+      dispatch(topoScanBlocks, false, [1, 1]);
+      dispatch(topoScanAdd, false, scanGroups);
+      dispatch(tearScatter, false);
+    }
+    if (readback.due(tick)) {
+      at('stats');
+      dispatch(frameStats, false);
+    }
+    timeline.end();
+    if (tear.enabled) {
+      // the scanned counts are the new offsets, the compacted rows replace
+      // the old ones. entries past the new total are never read
+      encoder.copyBufferToBuffer(
+          hashBuffer, 0, bufAdjOffsets, 0, (COUNT + 1) * 4);
+      encoder.copyBufferToBuffer(
+          bufAdjEdgesNext, 0, bufAdjEdges, 0, packedEdges.byteLength);
     }
 
     const lastReadA = (frame - 1) % 2 === 0;
@@ -434,16 +1010,27 @@ const createComputeSim: SimFactory = async (scene, renderer, gui) => {
       attrRef.buffer = targetBufferForRendering;
     }
 
+    readback.record(encoder, tick);
     device.queue.submit([encoder.finish()]);
+    readback.submitted();
+    gpuProfiler.submitted();
+    tick++;
     renderer.render(scene, camera);
   };
-  return {update, dispose};
+  return {update, dispose, onReadback, getStats};
 };
 
 const createWasmSim: SimFactory =
     async (scene, renderer, gui) => {
-  const P_STRIDE = 16;
-  const wasm: SimModule = await createSimModule();
+  const wasm = await simModule;
+  // interleaved render view layout, see ViewLayout in main.cpp
+  const P = {
+    stride: wasm.P_STRIDE,
+    x: wasm.P_X,
+    y: wasm.P_Y,
+    z: wasm.P_Z,
+    pinned: wasm.P_PINNED
+  };
   const world = new wasm.PhysicsWorld();
 
   world.createCloth(-400, -200, 0, 40, 30, 20, 1200, 10.0);
@@ -462,8 +1049,9 @@ const createWasmSim: SimFactory =
       });
 
 
-  const geometry = new THREE.SphereGeometry(25, 16, 16);
-  const material = new THREE.MeshPhysicalMaterial({
+  const SPHERE_RADIUS = 25;
+  const geometry = new THREE.SphereGeometry(SPHERE_RADIUS, 16, 16);
+  const material = new MeshPhysicalNodeMaterial({
     color: 0xff77aa,
     roughness: 0.35,
     metalness: 0.05,
@@ -476,6 +1064,31 @@ const createWasmSim: SimFactory =
     transparent: true,
   });
 
+  // the render view is already vec4 (x, y, z, pinned) in render space, so the
+  // instance buffer is just a window over the wasm heap that three uploads
+  // with a single writeBuffer. the heap can move on memory growth, so the
+  // window gets re-taken whenever its backing buffer changes
+  const viewLength = pCount * P.stride;
+  const heapView = () => {
+    const ptr = world.getPPtr() >> 2;
+    return wasm.HEAPF32.subarray(ptr, ptr + viewLength);
+  };
+  const renderAttr = new StorageInstancedBufferAttribute(heapView(), P.stride);
+  const syncRenderView = () => {
+    if (renderAttr.array.buffer !== wasm.HEAPF32.buffer) {
+      renderAttr.array = heapView();
+    }
+    renderAttr.needsUpdate = true;
+  };
+
+  const uScale = TSL.uniform(1.0);
+  const uColorDefault = TSL.uniform(new THREE.Color());
+  const uColorPinned = TSL.uniform(new THREE.Color());
+  const instance =
+      TSL.storage(renderAttr, 'vec4', pCount).element(TSL.instanceIndex);
+  material.positionNode = TSL.positionLocal.mul(uScale).add(instance.xyz);
+  material.colorNode = TSL.mix(uColorDefault, uColorPinned, instance.w);
+
   const particleMesh = new THREE.InstancedMesh(geometry, material, pCount);
   particleMesh.frustumCulled = false;
   particleMesh.castShadow = true;
@@ -484,8 +1097,6 @@ const createWasmSim: SimFactory =
   particleMesh.count = pCount;
   scene.add(particleMesh);
 
-  const dummy = new THREE.Object3D();
-
   //   raycaster.params.Sphere = {threshold: 5};
   const dragPlane = new THREE.Plane();
   const dragIntersectPoint = new THREE.Vector3();
@@ -515,30 +1126,34 @@ const createWasmSim: SimFactory =
     mouse.set(coords.x, coords.y);
     raycaster.setFromCamera(mouse, camera);
 
-    const intersects = raycaster.intersectObject(particleMesh);
+    // instances are placed on the gpu, so three's raycast can't see them, the
+    // world picks against its own positions instead
+    const {origin, direction} = raycaster.ray;
+    const hit = world.pickParticle(
+        origin.x, origin.y, origin.z, direction.x, direction.y, direction.z,
+        SPHERE_RADIUS * params.scale);
 
-    if (intersects.length > 0) {
+    if (hit >= 0) {
       controls.enabled = false;
-      intersects.sort((a, b) => a.distance - b.distance);
-      const hit = intersects[0];
-
-      if (hit.instanceId !== undefined) {
-        draggedIdx = hit.instanceId;
-        isDragging = true;
-        const currentlyPinned = world.isPinned(draggedIdx);
-
-        if (event.ctrlKey) {
-          const newState = !currentlyPinned;
-          world.setPinned(draggedIdx, newState);
-          wasAnchor = newState;
-        } else {
-          wasAnchor = currentlyPinned;
-          world.setPinned(draggedIdx, true);
-        }
-
-        const planeNormal = camera.position.clone().normalize();
-        dragPlane.setFromNormalAndCoplanarPoint(planeNormal, hit.point);
+      draggedIdx = hit;
+      isDragging = true;
+      const currentlyPinned = world.isPinned(draggedIdx);
+
+      if (event.ctrlKey) {
+        const newState = !currentlyPinned;
+        world.setPinned(draggedIdx, newState);
+        wasAnchor = newState;
+      } else {
+        wasAnchor = currentlyPinned;
+        world.setPinned(draggedIdx, true);
       }
+
+      const idx = (world.getPPtr() >> 2) + hit * P.stride;
+      const buffer = wasm.HEAPF32;
+      const hitPoint = new THREE.Vector3(
+          buffer[idx + P.x], buffer[idx + P.y], buffer[idx + P.z]);
+      const planeNormal = camera.position.clone().normalize();
+      dragPlane.setFromNormalAndCoplanarPoint(planeNormal, hitPoint);
     }else{
       controls.enabled = true;
     }
@@ -594,8 +1209,17 @@ const createWasmSim: SimFactory =
     stiffness: 1200,
     damping: 5.0,
     solver: 2,
-    simDt: 0.016,
-    useTicks: true,
+    fixedDt: 1 / 60,
+    maxSteps: 4,
+    xpbdIterations: 1,
+    selfCollision: false,
+    collisionRadius: 5,
+    sleep: false,
+    sleepEnergy: 50,
+    sleepSteps: 30,
+    deterministic: false,
+    simd: true,
+    threads: 1,
     emission: 0.0,
     transmission: 0.0,
     ior: 1.5,
@@ -604,6 +1228,11 @@ const createWasmSim: SimFactory =
     colorDefault: '#ffaa00',
     useHeatmap: false  // wip
   };
+  if (wasmResume) Object.assign(params, wasmResume.params);
+
+  uScale.value = params.scale;
+  uColorDefault.value.set(params.colorDefault);
+  uColorPinned.value.set(params.colorPinned);
 
   world.setGravity(0, params.gravity, 0);
   world.setWind(0, 0, 0);
@@ -623,13 +1252,32 @@ const createWasmSim: SimFactory =
       .name('Sub-Steps')
       .onChange((v: number) => world.setSubSteps(v));
 
+  const adaptive = {enabled: false, max: 32, courant: 0.5, steps: 0};
+  if (wasmResume) Object.assign(adaptive, wasmResume.adaptive);
+  const applyAdaptive = () => world.setAdaptiveSubSteps(
+      1, adaptive.enabled ? adaptive.max : 0, adaptive.courant);
+  folderSim.add(adaptive, 'enabled')
+      .name('Adaptive Sub-Steps')
+      .onChange(applyAdaptive);
+  folderSim.add(adaptive, 'max', 1, 64, 1)
+      .name('Max Sub-Steps')
+      .onChange(applyAdaptive);
+  folderSim.add(adaptive, 'courant', 0.1, 1.0, 0.05)
+      .name('Courant')
+      .onChange(applyAdaptive);
+  folderSim.add(adaptive, 'steps').name('Last Sub-Steps').listen().disable();
+
   folderSim.add(params, 'gravity', -10000, 10000)
       .name('Gravity (m/s²)')
       .onChange((v: number) => world.setGravity(0, v, 0));
 
-  folderSim.add(params, 'simDt', 0.005, 0.05)
+  folderSim.add(params, 'fixedDt', 0.005, 0.05)
       .name('Fixed TimeStep (s)')
-      .onChange((v: number) => world.setSimDt(v));
+      .onChange((v: number) => world.setFixedDt(v));
+
+  folderSim.add(params, 'maxSteps', 1, 16, 1)
+      .name('Max Steps / Frame')
+      .onChange((v: number) => world.setMaxSteps(v));
 
   const folderMat = gui.addFolder('Rendering');
   folderMat.add(params, 'metalness', 0, 1)
@@ -650,9 +1298,15 @@ const createWasmSim: SimFactory =
   folderMat.add(material, 'opacity', 0.0, 1.0)
       .name('primitive opacity')
       .onChange((v: number) => material.opacity = v);
-  folderMat.add(params, 'scale', 0.01, 4.0).name('scale');
-  folderMat.addColor(params, 'colorDefault').name('Default Color');
-  folderMat.addColor(params, 'colorPinned').name('Pinned Color');
+  folderMat.add(params, 'scale', 0.01, 4.0)
+      .name('scale')
+      .onChange((v: number) => uScale.value = v);
+  folderMat.addColor(params, 'colorDefault')
+      .name('Default Color')
+      .onChange((v: string) => uColorDefault.value.set(v));
+  folderMat.addColor(params, 'colorPinned')
+      .name('Pinned Color')
+      .onChange((v: string) => uColorPinned.value.set(v));
   // folderMat.add(params, 'useHeatmap').name('Velocity Heatmap'); //todo
 
   const folderPhys = gui.addFolder('Physics Properties');
@@ -682,31 +1336,99 @@ const createWasmSim: SimFactory =
         'RK2 (Midpoint)': 4,
         'RK4 (Runge-Kutta)': 5,
         'Implicit Euler (Damped)': 6,
-        'Velocity Verlet': 7
+        'Velocity Verlet': 7,
+        'XPBD (Gauss-Seidel)': 8
       })
       .name('Integrator')
       .onChange((v: number) => world.setSolver(v));
 
-  folderSolver.add(params, 'useTicks')
-      .name('Ticks instead of time')
-      .onChange((v: boolean) => world.set_use_ticks(v));
+  folderSolver.add(params, 'xpbdIterations', 1, 8, 1)
+      .name('XPBD iterations')
+      .onChange((v: number) => world.setXpbdIterations(v));
+
+  folderSolver.add(params, 'threads', 1, navigator.hardwareConcurrency || 1, 1)
+      .name('Threads')
+      .onChange((v: number) => world.setThreadCount(v));
+
+  if (world.hasSimd()) {
+    folderSolver.add(params, 'simd')
+        .name('SIMD128 kernels')
+        .onChange((v: boolean) => world.setUseSimd(v));
+  }
+
+  const folderCollision = gui.addFolder('Self Collision');
+  folderCollision.add(params, 'selfCollision')
+      .name('enabled')
+      .onChange((v: boolean) => world.setSelfCollision(v));
+  folderCollision.add(params, 'collisionRadius', 1, 10)
+      .name('radius')
+      .onChange((v: number) => world.setCollisionRadius(v));
+
+  // settled 8x8 tiles stop until poked, see setSleepThreshold
+  const applySleep = () => world.setSleepThreshold(
+      params.sleep ? params.sleepEnergy : 0, params.sleepSteps);
+  const folderSleep = gui.addFolder('Sleeping');
+  folderSleep.add(params, 'sleep').name('enabled').onChange(applySleep);
+  folderSleep.add(params, 'sleepEnergy', 1, 500)
+      .name('energy threshold')
+      .onChange(applySleep);
+  folderSleep.add(params, 'sleepSteps', 1, 240, 1)
+      .name('still steps')
+      .onChange(applySleep);
+  const sleepStats = {tiles: 0};
+  folderSleep.add(sleepStats, 'tiles').name('asleep tiles').listen().disable();
 
   const debug = {
     explode: () => {
-      params.simDt = 0.05;
-      world.setSimDt(0.05);
+      params.fixedDt = 0.05;
+      world.setFixedDt(0.05);
     }
   };
   folderSolver.add(debug, 'explode')
       .name('Break Physics (0.05 dt) explicit euler might explode');
 
-  const cPinned = new THREE.Color();
-  const cDefault = new THREE.Color();
+  world.setFixedDt(params.fixedDt);
+  world.setMaxSteps(params.maxSteps);
 
-  const fixedDt = 1 / 120;
-  world.setFixedDt(fixedDt);
-
-  let last = performance.now();
+  // snapshots go through the upload scratch, there is no exported malloc to
+  // hand the world a buffer of our own
+  const saveState = () => {
+    const size = world.getSnapshotSize();
+    const ptr = world.getUploadPtr(Math.ceil(size / 4));
+    world.saveSnapshot(ptr, size);
+    return new Uint8Array(wasm.HEAPF32.buffer, ptr, size).slice();
+  };
+  const restoreState = (state: Uint8Array) => {
+    const ptr = world.getUploadPtr(Math.ceil(state.length / 4));
+    new Uint8Array(wasm.HEAPF32.buffer, ptr, state.length).set(state);
+    return world.restoreSnapshot(ptr, state.length);
+  };
+  if (wasmResume) {
+    world.setThreadCount(params.threads);
+    restoreState(wasmResume.state);
+    wasmResume = null;
+  }
+  // the snapshot carries the world's parameters, the gui ones go with it
+  let saved: {state: Uint8Array, params: typeof params}|null = null;
+  const folderSnapshot = gui.addFolder('Snapshot');
+  folderSnapshot
+      .add({save: () => saved = {state: saveState(), params: {...params}}}, 'save')
+      .name('save state');
+  folderSnapshot
+      .add(
+          {
+            restore: () => {
+              if (!saved) return;
+              restoreState(saved.state);
+              Object.assign(params, saved.params);
+              gui.controllersRecursive().forEach(c => c.updateDisplay());
+            }
+          },
+          'restore')
+      .name('restore state');
+  folderSnapshot.add(params, 'deterministic')
+      .name('deterministic stepping')
+      .onChange((v: boolean) => world.setDeterministic(v));
 
 
   await renderer.init();  // not sure
@@ -720,7 +1442,6 @@ const createWasmSim: SimFactory =
 
 
 
-    scene.remove(dummy);
     scene.remove(particleMesh);
     particleMesh.geometry.dispose();
     if (particleMesh.material.map) particleMesh.material.map.dispose();
@@ -728,56 +1449,385 @@ const createWasmSim: SimFactory =
 
     destroyer.forEach(res => res.destroy());  // useless here but in case i add
                                               // buffers here as well
+    wasmResume =
+        {state: saveState(), params: {...params}, adaptive: {...adaptive}};
     world.delete();
   };
 
   const update = (dt: number) => {
-    // world.update(dtMs * 0.001 * params.timeScale);
-    const frameDt = (dt - last) * 0.001;
-    last = dt;
+    // dt is the frame time in seconds, the world steps at fixedDt on its own
+    world.update(dt * params.timeScale);
+    sleepStats.tiles = world.getSleepingTiles();
+    adaptive.steps = world.getSubSteps();
+
+    syncRenderView();
+  };
+  // a build without SIM_PROFILE has nothing to show
+  const getStats = world.hasProfiler() ?
+      () => readWasmStats(wasm, world.getStatsPtr()) :
+      undefined;
+  return {update, dispose, getStats};
+}
 
-    world.update(frameDt * params.timeScale);
+// the wasm cloth with the world stepping on a pthread of its own (SimHost).
+// a frame only takes the newest finished view out of the triple buffer and
+// queues inputs, nothing here waits on the physics
+const createHostedSim: SimFactory = async (scene, renderer, gui) => {
+  const wasm = await simModule;
+  const P = {stride: wasm.P_STRIDE, x: wasm.P_X, y: wasm.P_Y, z: wasm.P_Z};
+  const host = new wasm.SimHost();
+  host.createCloth(-400, -200, 0, 40, 30, 20, 1200, 10.0);
+  const pCount = host.getPCount();
 
-    const pPtr = world.getPPtr() >> 2;
-    const buffer = wasm.HEAPF32;
+  const params = {
+    timeScale: 1.0,
+    subSteps: 8,
+    gravity: 981,
+    stiffness: 1200,
+    damping: 5.0,
+    solver: 2,
+    threads: 1,
+    frame: 0
+  };
+  host.setGravity(0, params.gravity, 0);
+  host.setDamping(0.99);
+  host.setSpringParams(params.stiffness, params.damping);
+  host.setSubSteps(params.subSteps);
+  host.setSolver(params.solver);
+  host.start();
+
+  const SPHERE_RADIUS = 25;
+  const geometry = new THREE.SphereGeometry(SPHERE_RADIUS, 16, 16);
+  const material =
+      new MeshStandardNodeMaterial({roughness: 0.5, metalness: 0.5});
+
+  // the front slot stays ours until the next acquire, so three can upload
+  // straight out of it this frame
+  const viewLength = pCount * P.stride;
+  const frontView = () => {
+    const ptr = host.acquire() >> 2;
+    return wasm.HEAPF32.subarray(ptr, ptr + viewLength);
+  };
+  const renderAttr = new StorageInstancedBufferAttribute(frontView(), P.stride);
+  const instance =
+      TSL.storage(renderAttr, 'vec4', pCount).element(TSL.instanceIndex);
+  material.positionNode = TSL.positionLocal.add(instance.xyz);
+  material.colorNode = TSL.mix(
+      TSL.color(0xffaa00), TSL.color(0xff00aa), instance.w);
 
+  const particleMesh = new THREE.InstancedMesh(geometry, material, pCount);
+  particleMesh.frustumCulled = false;
+  particleMesh.castShadow = true;
+  scene.add(particleMesh);
 
+  const dragPlane = new THREE.Plane();
+  const dragPoint = new THREE.Vector3();
+  let draggedIdx = -1;
+  let wasAnchor = false;
 
-    for (let i = 0; i < pCount; i++) {
-      const idx = pPtr + i * P_STRIDE;
-      const x = buffer[idx];
-      const y = buffer[idx + 1];
-      const z = buffer[idx + 2];
+  const setRay = (event: PointerEvent) => {
+    const rect = renderer.domElement.getBoundingClientRect();
+    mouse.set(
+        ((event.clientX - rect.left) / rect.width) * 2 - 1,
+        -((event.clientY - rect.top) / rect.height) * 2 + 1);
+    raycaster.setFromCamera(mouse, camera);
+  };
+  const onPointerDown = (event: PointerEvent) => {
+    if (event.button !== 0) return;
+    setRay(event);
+    const {origin, direction} = raycaster.ray;
+    // picks against the frame on screen, not the one being stepped
+    const hit = host.pickParticle(
+        origin.x, origin.y, origin.z, direction.x, direction.y, direction.z,
+        SPHERE_RADIUS);
+    if (hit < 0) return;
+    controls.enabled = false;
+    draggedIdx = hit;
+    wasAnchor = host.isPinned(hit);
+    host.setPinned(hit, true);
+    const at = hit * P.stride;
+    const view = renderAttr.array as Float32Array;
+    dragPlane.setFromNormalAndCoplanarPoint(
+        camera.position.clone().normalize(),
+        new THREE.Vector3(view[at + P.x], view[at + P.y], view[at + P.z]));
+  };
+  const onPointerMove = (event: PointerEvent) => {
+    if (draggedIdx === -1) return;
+    setRay(event);
+    if (raycaster.ray.intersectPlane(dragPlane, dragPoint))
+      host.setParticlePos(draggedIdx, dragPoint.x, -dragPoint.y, dragPoint.z);
+  };
+  const onPointerUp = () => {
+    controls.enabled = true;
+    if (draggedIdx === -1) return;
+    host.setPinned(draggedIdx, wasAnchor);
+    draggedIdx = -1;
+  };
+  const dom = renderer.domElement;
+  dom.addEventListener('pointerdown', onPointerDown);
+  dom.addEventListener('pointermove', onPointerMove);
+  window.addEventListener('pointerup', onPointerUp);
 
-      const isPinned = buffer[idx + 13] > 0.5;
+  const folder = gui.addFolder('Worker Host');
+  folder.add(params, 'timeScale', 0.0, 2.0)
+      .name('Time Scale')
+      .onChange((v: number) => host.setTimeScale(v));
+  folder.add(params, 'subSteps', 1, 20, 1)
+      .name('Sub-Steps')
+      .onChange((v: number) => host.setSubSteps(v));
+  folder.add(params, 'gravity', -10000, 10000)
+      .name('Gravity (m/s²)')
+      .onChange((v: number) => host.setGravity(0, v, 0));
+  folder.add(params, 'stiffness', 100, 8000)
+      .name('Spring Stiffness (k)')
+      .onChange((v: number) => host.setSpringParams(v, params.damping));
+  folder.add(params, 'damping', 0, 20)
+      .name('Spring Damping')
+      .onChange((v: number) => host.setSpringParams(params.stiffness, v));
+  folder
+      .add(params, 'solver', {
+        'Explicit Euler (Unstable)': 0,
+        'Symplectic Euler': 1,
+        'Verlet (Standard)': 2,
+        'TC Verlet (Variable FPS)': 3,
+        'RK2 (Midpoint)': 4,
+        'RK4 (Runge-Kutta)': 5,
+        'Implicit Euler (Damped)': 6,
+        'Velocity Verlet': 7,
+        'XPBD (Gauss-Seidel)': 8
+      })
+      .name('Integrator')
+      .onChange((v: number) => host.setSolver(v));
+  // the host thread comes out of the same pthread pool
+  folder
+      .add(
+          params, 'threads', 1,
+          Math.max(1, (navigator.hardwareConcurrency || 2) - 1), 1)
+      .name('Threads')
+      .onChange((v: number) => host.setThreadCount(v));
+  folder.add(params, 'frame').name('physics step').listen().disable();
+
+  const dispose = () => {
+    dom.removeEventListener('pointerdown', onPointerDown);
+    dom.removeEventListener('pointermove', onPointerMove);
+    window.removeEventListener('pointerup', onPointerUp);
+    scene.remove(particleMesh);
+    geometry.dispose();
+    material.dispose();
+    host.stop();
+    host.delete();
+  };
+  const update = () => {
+    // time runs on the host, the frame time isn't needed here
+    renderAttr.array = frontView();
+    renderAttr.needsUpdate = true;
+    params.frame = host.getFrame();
+  };
+  // the host copies the stats along with every frame it publishes
+  const getStats = host.hasProfiler() ?
+      () => readWasmStats(wasm, host.getStatsPtr()) :
+      undefined;
+  return {update, dispose, getStats};
+};
 
+// a field of cloths in one WorldBatch. a cloth drops to a coarser level of
+// its grid once the cells get small on screen, and to the coarsest one off
+// screen. the mesh always has the full grid: its vertices only carry their
+// spot on the sheet, the vertex stage upsamples whatever level is being
+// stepped from the batch view, so a level switch never touches geometry
+const createBatchSim: SimFactory = async (scene, renderer, gui) => {
+  const wasm = await simModule;
+  const batch = new wasm.WorldBatch();
+
+  const GRID = 64;
+  const SEP = 8;
+  const COLS = 8;
+  const ROWS = 8;
+  const spacing = GRID * SEP * 1.25;
+  for (let r = 0; r < ROWS; r++) {
+    for (let c = 0; c < COLS; c++) {
+      const id = batch.addCloth(
+          (c - COLS / 2) * spacing, -200, -r * spacing, GRID, GRID, SEP, 1200,
+          10.0);
+      batch.setWind(id, 0, 0, 150 + 100 * Math.sin(id));
+    }
+  }
+  const worlds = batch.getWorldCount();
+  const pCount = batch.getPCount();
+
+  const params = {
+    lod: true,
+    cellPixels: 6,
+    subSteps: 8,
+    threads: Math.max(1, (navigator.hardwareConcurrency || 2) - 1),
+    simulated: 0,
+    levels: ''
+  };
+  batch.setGravity(-1, 0, 981, 0);
+  batch.setDamping(-1, 0.99);
+  batch.setSubSteps(-1, params.subSteps);
+  batch.setSolver(-1, 2);
+  batch.setThreadCount(params.threads);
+
+  // both tables are windows over the wasm heap, re-taken when it grows
+  const viewLength = pCount * wasm.P_STRIDE;
+  const lodLength = worlds * wasm.LOD_STRIDE;
+  const heapView = (ptr: number, length: number) =>
+      wasm.HEAPF32.subarray(ptr >> 2, (ptr >> 2) + length);
+  const renderAttr = new StorageInstancedBufferAttribute(
+      heapView(batch.getPPtr(), viewLength), wasm.P_STRIDE);
+  const lodAttr = new StorageInstancedBufferAttribute(
+      heapView(batch.getLodPtr(), lodLength), 4);
+  const lod = () => lodAttr.array as Float32Array;
+
+  // position holds (u, v, world) of the vertex on its sheet, the level being
+  // stepped is sampled bilinearly at (u, v)
+  const view = TSL.storage(renderAttr, 'vec4', pCount);
+  const table = TSL.storage(lodAttr, 'vec4', lodLength / 4);
+  const sheet = TSL.positionGeometry;
+  const record = table.element(
+      TSL.int(sheet.z).mul(wasm.LOD_STRIDE / 4).add(wasm.LOD_FIRST / 4));
+  const size = TSL.vec2(record.y, record.z);
+  const at = sheet.xy.mul(size.sub(1));
+  const cell = TSL.min(TSL.floor(at), size.sub(2));
+  const t = at.sub(cell);
+  const first = TSL.int(record.x.add(cell.y.mul(size.x)).add(cell.x));
+  const below = TSL.int(size.x);
+  const p = TSL.mix(
+      TSL.mix(view.element(first), view.element(first.add(1)), t.x),
+      TSL.mix(
+          view.element(first.add(below)),
+          view.element(first.add(below).add(1)), t.x),
+      t.y);
 
-      if (isPinned) {
-        particleMesh.setColorAt(i, cPinned);
+  const material = new MeshStandardNodeMaterial({
+    roughness: 0.6,
+    metalness: 0.1,
+    side: THREE.DoubleSide,
+    flatShading: true
+  });
+  material.positionNode = p.xyz;
+  material.colorNode = TSL.mix(TSL.color(0xffaa00), TSL.color(0xff00aa), p.w);
+
+  const indices: number[] = [];
+  for (let y = 0; y < GRID - 1; y++) {
+    for (let x = 0; x < GRID - 1; x++) {
+      const i = y * GRID + x;
+      indices.push(i, i + GRID, i + 1, i + 1, i + GRID, i + GRID + 1);
+    }
+  }
+  const index = new THREE.Uint32BufferAttribute(indices, 1);
+  // the meshes cull against the sphere the batch measures every frame,
+  // three can't compute one from the sheet coordinates
+  const meshes = Array.from({length: worlds}, (_, w) => {
+    const sheetPos = new Float32Array(GRID * GRID * 3);
+    for (let i = 0; i < GRID * GRID; i++) {
+      sheetPos[i * 3] = (i % GRID) / (GRID - 1);
+      sheetPos[i * 3 + 1] = Math.floor(i / GRID) / (GRID - 1);
+      sheetPos[i * 3 + 2] = w;
+    }
+    const geometry = new THREE.BufferGeometry();
+    geometry.setAttribute('position', new THREE.BufferAttribute(sheetPos, 3));
+    geometry.setIndex(index);
+    geometry.boundingSphere = new THREE.Sphere();
+    const mesh = new THREE.Mesh(geometry, material);
+    mesh.castShadow = true;
+    mesh.receiveShadow = true;
+    scene.add(mesh);
+    return mesh;
+  });
+  const syncViews = () => {
+    if (renderAttr.array.buffer !== wasm.HEAPF32.buffer) {
+      renderAttr.array = heapView(batch.getPPtr(), viewLength);
+      lodAttr.array = heapView(batch.getLodPtr(), lodLength);
+    }
+    renderAttr.needsUpdate = true;
+    lodAttr.needsUpdate = true;
+    const r = lod();
+    meshes.forEach((mesh, w) => {
+      const o = w * wasm.LOD_STRIDE;
+      const sphere = mesh.geometry.boundingSphere!;
+      sphere.center.fromArray(r, o + wasm.LOD_CENTER);
+      sphere.radius = r[o + wasm.LOD_RADIUS];
+    });
+  };
+  syncViews();
+
+  // the coarsest level whose cells stay under cellPixels on screen. going
+  // coarser wants a margin so a cloth on the edge doesn't flip every frame
+  const frustum = new THREE.Frustum();
+  const viewProj = new THREE.Matrix4();
+  const levelCounts: number[] = new Array(batch.getLevelCount(0)).fill(0);
+  const chooseLevels = () => {
+    viewProj.multiplyMatrices(
+        camera.projectionMatrix, camera.matrixWorldInverse);
+    frustum.setFromProjectionMatrix(viewProj);
+    const pixels = renderer.domElement.height /
+        (2 * Math.tan(THREE.MathUtils.degToRad(camera.fov) / 2));
+    levelCounts.fill(0);
+    params.simulated = 0;
+    meshes.forEach((mesh, w) => {
+      const coarsest = batch.getLevelCount(w) - 1;
+      let level = batch.getLevel(w);
+      const sphere = mesh.geometry.boundingSphere!;
+      if (!params.lod) {
+        level = 0;
+      } else if (!frustum.intersectsSphere(sphere)) {
+        level = coarsest;
       } else {
-        particleMesh.setColorAt(i, cDefault);
+        const dist = Math.max(
+            1, sphere.center.distanceTo(camera.position) - sphere.radius);
+        const cellPx = SEP * pixels / dist;
+        const fits = (l: number, slack: number) =>
+            cellPx * 2 ** l <= params.cellPixels * slack;
+        while (level > 0 && !fits(level, 1)) level--;
+        while (level < coarsest && fits(level + 1, 0.75)) level++;
       }
+      if (level !== batch.getLevel(w)) batch.setLevel(w, level);
+      levelCounts[level]++;
+      const o = w * wasm.LOD_STRIDE;
+      params.simulated += lod()[o + wasm.LOD_W] * lod()[o + wasm.LOD_H];
+    });
+    params.levels = levelCounts.join(' / ');
+  };
 
-      cPinned.set(params.colorPinned);
-      cDefault.set(params.colorDefault);
+  const folder = gui.addFolder('Batch');
+  folder.add(params, 'lod').name('Level of Detail');
+  folder.add(params, 'cellPixels', 1, 32).name('Cell Size (px)');
+  folder.add(params, 'subSteps', 1, 20, 1)
+      .name('Sub-Steps')
+      .onChange((v: number) => batch.setSubSteps(-1, v));
+  folder
+      .add(
+          params, 'threads', 1,
+          Math.max(1, (navigator.hardwareConcurrency || 2) - 1), 1)
+      .name('Threads')
+      .onChange((v: number) => batch.setThreadCount(v));
+  folder.add(params, 'simulated').name('particles stepped').listen().disable();
+  folder.add(params, 'levels').name('cloths per level').listen().disable();
 
-      dummy.position.set(x, -y, z);
-      dummy.scale.set(params.scale, params.scale, params.scale);
-      dummy.updateMatrix();
-      particleMesh.setMatrixAt(i, dummy.matrix);
+  const update = (dt: number) => {
+    chooseLevels();
+    batch.update(dt);
+    syncViews();
+  };
+  const dispose = () => {
+    for (const mesh of meshes) {
+      scene.remove(mesh);
+      mesh.geometry.dispose();
     }
-    particleMesh.instanceMatrix.needsUpdate = true;
-    if (particleMesh.instanceColor)
-      particleMesh.instanceColor.needsUpdate = true;
-
-    // not sure if this would slow down the sim too much or not
-    particleMesh.geometry.computeBoundingSphere();
-    particleMesh.geometry.computeBoundingBox();
-    particleMesh.computeBoundingSphere();
-    particleMesh.updateMatrixWorld(true);
+    material.dispose();
+    batch.delete();
   };
   return {update, dispose};
-}
+};
+
+const simFactories: Record<mode, SimFactory> = {
+  [mode.wasm]: createWasmSim,
+  [mode.compute]: createComputeSim,
+  [mode.hosted]: createHostedSim,
+  [mode.batch]: createBatchSim
+};
 
 const switchSim = async (factory: SimFactory) => {
   if (currentSim) {
@@ -788,7 +1838,9 @@ const switchSim = async (factory: SimFactory) => {
     guiSim.destroy();
   }
   guiSim = new GUI({title: 'Sim Settings'});
+  statsPanel = null;
   currentSim = await factory(scene, renderer, guiSim);
+  if (currentSim.getStats) statsPanel = new StatsPanel(guiSim);
 };
 
 const clock = new THREE.Timer();
@@ -799,17 +1851,22 @@ renderer.setAnimationLoop(() => {
 
   if (currentSim) {
     currentSim.update(dt);
+    if (statsPanel && currentSim.getStats)
+      statsPanel.update(currentSim.getStats());
   }
 
   renderer.render(scene, camera);
 });
 
 
-guiSwitch.add(global_params, 'mode', {'wasm (1k spheres)': 0, 'compute (40k points)': 1})
+guiSwitch
+    .add(global_params, 'mode', {
+      'wasm (1k spheres)': mode.wasm,
+      'compute (40k points)': mode.compute,
+      'wasm on a worker (1k spheres)': mode.hosted,
+      'wasm batch with lod (64 cloths)': mode.batch
+    })
     .name('simulator')
-    .onChange((v: number) => {
-      switchSim(v > 0.5 ? createComputeSim : createWasmSim);
-    });
+    .onChange((v: mode) => switchSim(simFactories[v]));
 
-switchSim(
-    global_params.mode === mode.compute ? createComputeSim : createWasmSim);
+switchSim(simFactories[global_params.mode]);
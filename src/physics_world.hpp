@@ -0,0 +1,2896 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "colliders.hpp"
+#include "profiler.hpp"
+#include "spatial_hash.hpp"
+#include "thread_pool.hpp"
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+enum SolverType {
+	SOLVER_EXPLICIT_EULER = 0,
+	SOLVER_SYMPLECTIC_EULER = 1,
+	SOLVER_VERLET = 2,
+	SOLVER_TIME_CORRECTED_VERLET = 3,
+	SOLVER_RK2 = 4,
+	SOLVER_RK4 = 5,
+	SOLVER_IMPLICIT_EULER = 6,
+	SOLVER_VEOLCITY_VERLET = 7,
+	SOLVER_XPBD = 8
+};
+
+template <class T, std::size_t Align = 16> struct AlignedAllocator {
+	using value_type = T;
+
+	AlignedAllocator() = default;
+	template <class U>
+	constexpr AlignedAllocator(const AlignedAllocator<U, Align> &) noexcept {}
+
+	template <class U> struct rebind {
+		using other = AlignedAllocator<U, Align>;
+	};
+
+	[[nodiscard]] T *allocate(std::size_t n) {
+		return static_cast<T *>(
+		           ::operator new(n * sizeof(T), std::align_val_t{Align}));
+	}
+	void deallocate(T *p, std::size_t) noexcept {
+		::operator delete(p, std::align_val_t{Align});
+	}
+
+	template <class U>
+	constexpr bool operator==(const AlignedAllocator<U, Align> &) const noexcept {
+		return true;
+	}
+};
+
+template <class T> using AlignedVec = std::vector<T, AlignedAllocator<T>>;
+
+// soa particle storage, every field is its own 16 byte aligned stream so a
+// pass only pulls the fields it actually touches into cache
+struct Particles {
+	AlignedVec<float> px, py, pz;
+	AlignedVec<float> ox, oy, oz; // previous position (verlet)
+	AlignedVec<float> vx, vy, vz;
+	AlignedVec<float> ax, ay, az;
+	AlignedVec<float> mass, inv_mass;
+	AlignedVec<float> pinned; // 1.0 pinned, 0.0 free
+	AlignedVec<float> frozen; // 1.0 pinned or asleep, what the solvers test
+	AlignedVec<float> prev_dt;
+
+	[[nodiscard]] std::size_t size() const {
+		return px.size();
+	}
+
+	template <class F> void for_each_stream(F &&f) {
+		for (auto *s : {&px, &py, &pz, &ox, &oy, &oz, &vx, &vy, &vz, &ax, &ay, &az,
+		                &mass, &inv_mass, &pinned, &frozen, &prev_dt})
+			f(*s);
+	}
+
+	void clear() {
+		for_each_stream([](auto &s) { s.clear(); });
+	}
+	void reserve(std::size_t n) {
+		for_each_stream([n](auto &s) { s.reserve(n); });
+	}
+
+	void push(Vec3 p, float m, bool pin) {
+		px.push_back(p.x);
+		py.push_back(p.y);
+		pz.push_back(p.z);
+		ox.push_back(p.x);
+		oy.push_back(p.y);
+		oz.push_back(p.z);
+		for (auto *s : {&vx, &vy, &vz, &ax, &ay, &az})
+			s->push_back(0.0f);
+		mass.push_back(m);
+		inv_mass.push_back(1.0f / m);
+		pinned.push_back(pin ? 1.0f : 0.0f);
+		frozen.push_back(pin ? 1.0f : 0.0f);
+		prev_dt.push_back(1.0f / 60.0f);
+	}
+
+	[[nodiscard]] Vec3 pos(std::size_t i) const {
+		return {px[i], py[i], pz[i]};
+	}
+	[[nodiscard]] Vec3 old_pos(std::size_t i) const {
+		return {ox[i], oy[i], oz[i]};
+	}
+	[[nodiscard]] Vec3 vel(std::size_t i) const {
+		return {vx[i], vy[i], vz[i]};
+	}
+	[[nodiscard]] Vec3 acc(std::size_t i) const {
+		return {ax[i], ay[i], az[i]};
+	}
+	void set_pos(std::size_t i, Vec3 v) {
+		px[i] = v.x;
+		py[i] = v.y;
+		pz[i] = v.z;
+	}
+	void set_old_pos(std::size_t i, Vec3 v) {
+		ox[i] = v.x;
+		oy[i] = v.y;
+		oz[i] = v.z;
+	}
+	void set_vel(std::size_t i, Vec3 v) {
+		vx[i] = v.x;
+		vy[i] = v.y;
+		vz[i] = v.z;
+	}
+	void set_acc(std::size_t i, Vec3 v) {
+		ax[i] = v.x;
+		ay[i] = v.y;
+		az[i] = v.z;
+	}
+	void add_acc(std::size_t i, Vec3 v) {
+		ax[i] += v.x;
+		ay[i] += v.y;
+		az[i] += v.z;
+	}
+	[[nodiscard]] bool is_pinned(std::size_t i) const {
+		return pinned[i] > 0.5f;
+	}
+	[[nodiscard]] bool is_frozen(std::size_t i) const {
+		return frozen[i] > 0.5f;
+	}
+};
+
+// layout of the interleaved render view exported through getPPtr, in floats.
+// js reads this through the P_* module constants instead of hardcoding it.
+// positions are already in render space (sim y points down, render y up) and
+// the record is a plain vec4 so the whole view can be uploaded as one
+// storage/instance buffer
+enum ViewLayout {
+	VIEW_X = 0,
+	VIEW_Y = 1,
+	VIEW_Z = 2,
+	VIEW_PINNED = 3,
+	VIEW_STRIDE = 4
+};
+
+struct Spring {
+	int p1, p2;
+	float rest_len, k, damp;
+	float tear; // breaks past this strain (stretch / rest length), 0 never
+};
+
+// one directed csr entry, a vec4 so the gpu can bind the array as is
+struct Edge {
+	float rest_len, k, damp, tear;
+};
+
+// save_snapshot layout: SnapshotHeader, SnapshotParams, then every array of
+// PhysicsWorld::for_each_snapshot_array as a uint32 element count followed
+// by the raw elements, padded to 4 bytes. raw structs, so a snapshot only
+// loads into the same build (layout guards against the obvious mismatches)
+constexpr std::uint32_t SNAPSHOT_MAGIC = 0x48544c43; // "CLTH"
+constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader {
+	std::uint32_t magic, version, layout, size;
+};
+
+struct SnapshotParams {
+	Vec3 gravity, wind;
+	float global_damping;
+	int sub_steps;
+	int adaptive_min, adaptive_max;
+	float adaptive_courant, adaptive_observed;
+	int adaptive_last;
+	int solver;
+	float fixed_dt, accumulator, alpha;
+	int max_steps;
+	int use_simd;
+	int cg_max_iters;
+	float cg_tolerance;
+	int cg_last_iters;
+	int xpbd_iterations;
+	int self_collision;
+	float collision_radius, hash_cell;
+	int hash_table;
+	int tearing, broken_springs;
+	int sleep_enabled;
+	float sleep_energy;
+	int sleep_steps, grid_w, grid_h, tiles_x, tiles_y, asleep_count;
+	float uniform_mass, uniform_k, uniform_damp;
+	int uniform_mass_set, uniform_springs_set;
+	int deterministic;
+};
+
+class PhysicsWorld {
+	Particles particles;
+	std::vector<Spring> springs;
+
+	// csr neighbour index, built from springs. row i is
+	// [adj_offsets[i], adj_offsets[i + 1]) into adj_indices/adj_data and holds
+	// every spring touching i, with the spring's parameters copied inline
+	AlignedVec<std::uint32_t> adj_offsets;
+	AlignedVec<std::uint32_t> adj_indices;
+	AlignedVec<Edge> adj_data;
+
+	// springs are stored sorted by colour, batch b is
+	// [batch_offsets[b], batch_ends[b]) and no two springs in a batch share a
+	// particle, so a batch can be scattered in parallel without atomics. torn
+	// springs are swapped behind batch_ends[b] with k = damp = 0, the array
+	// itself never shrinks
+	std::vector<int> batch_offsets{0};
+	std::vector<int> batch_ends;
+	bool tearing = false;
+	int broken_springs = 0;
+	// build_csr and tear_springs scratch, sized by build_csr whenever the
+	// topology changes, so tearing a spring doesn't allocate
+	AlignedVec<std::uint32_t> csr_cursor;
+	std::vector<int> torn;
+
+	// what set_mass / set_spring_params last broadcast, as long as nothing per
+	// particle or per spring has overridden it since. setting the same value
+	// again is a no-op instead of a rewrite (and wake) of every element
+	struct {
+		float mass = 1.0f;
+		float k = 0.0f, damp = 0.0f;
+		bool mass_set = true;
+		bool springs_set = false;
+	} uniform;
+	// see get_upload_ptr
+	AlignedVec<float> upload;
+
+	// create_mesh input, js writes it through get_mesh_*_ptr. kept between
+	// scenes along with the builder scratch, so loading the next garment of
+	// similar size reuses the same heap blocks instead of fragmenting it
+	struct {
+		AlignedVec<float> vertices; // xyz, render space
+		AlignedVec<std::uint32_t> indices; // 3 per triangle
+	} mesh_in;
+	struct {
+		// open addressing edge set keyed by (min << 32 | max), the value is the
+		// spring the edge became
+		std::vector<std::uint64_t> keys;
+		std::vector<std::uint32_t> spring;
+		// corners opposite each triangle edge on its first two triangles
+		std::vector<std::int32_t> opposite;
+		std::vector<int> colors;
+		std::vector<std::uint64_t> masks;
+		std::vector<Spring> sorted;
+		std::vector<int> cursor;
+	} build;
+
+	// interleaved VIEW_STRIDE floats per particle, refreshed at the end of
+	// update. sized once per topology so the pointer js holds stays put
+	AlignedVec<float> view;
+
+	Vec3 gravity{0.0f, -9.81f, 0.0f};
+	Vec3 wind{0.0f, 0.0f, 0.0f};
+
+	float global_damping = 0.99f;
+	int sub_steps = 8;
+
+	// adaptive substepping, off while max_steps is 0. every step picks
+	// ceil(dt / h) substeps within [min_steps, max_steps], h being courant
+	// times the smaller of the explicit stability limit of the stiffest row
+	// (2 / omega, gershgorin bound on k / m, skipped for the implicit solvers)
+	// and the step that keeps every spring's length change under its rest
+	// length. the latter uses the fastest relative spring speed
+	// (|v_rel . dir| / rest) that solve_springs / xpbd_project saw during the
+	// previous step
+	struct {
+		int min_steps = 1;
+		int max_steps = 0;
+		float courant = 0.5f;
+		bool bound_dirty = true;
+		float omega = 0.0f; // sqrt of the gershgorin bound
+		float zeta = 0.0f;  // same bound on the damping
+		std::atomic<float> rate{0.0f}; // this step so far
+		float observed = 0.0f;        // the last whole step
+		int last_steps = 8;
+	} adaptive;
+
+	SolverType current_solver = SOLVER_VERLET;
+
+	// update runs whole fixed_dt steps out of the accumulator and carries the
+	// remainder, capped at max_steps per call so a long frame can't snowball.
+	// the view is blended between the last two steps by alpha
+	float fixed_dt = 1.0f / 60.0f;
+	float accumulator = 0.0f;
+	float alpha = 1.0f;
+	int max_steps = 4;
+
+	// positions before the most recent step, for the interpolated view
+	struct {
+		AlignedVec<float> px, py, pz;
+	} prev;
+
+	// runtime switch between the simd128 and scalar kernels, only meaningful
+	// when built with SIM_SIMD
+	bool use_simd = true;
+
+	ThreadPool pool;
+	// phase timings when built with SIM_PROFILE, see get_stats_ptr
+	Profiler profile;
+	// reductions over a fixed partition instead of one chunk per thread, so
+	// the results don't depend on set_thread_count, see reduce_sum
+	bool deterministic = false;
+	static constexpr int REDUCE_CHUNKS = 64;
+
+	// read-only copy of pos/vel that the rk passes gather neighbours from, so a
+	// partition can write its own particles without racing other gathers
+	struct {
+		AlignedVec<float> px, py, pz, vx, vy, vz;
+	} rk_src;
+
+	// backward euler scratch. per csr entry the linearized spring block
+	// h^2 K + h D is a * I + b * dir dir^T, per particle the cg vectors
+	struct EdgeBlock {
+		Vec3 dir;
+		float a, b;
+		float ka, kb; // h^2 K alone, for the rhs
+	};
+	struct {
+		std::vector<EdgeBlock> blocks;
+		std::vector<Vec3> rhs, x, r, z, p, q, inv_diag;
+		std::vector<double> partials;
+		int max_iters = 32;
+		float tolerance = 1e-3f;
+		int last_iters = 0;
+	} cg;
+
+	// xpbd lagrange multipliers, one per spring in batch order. reset at the
+	// start of every substep
+	AlignedVec<float> xpbd_lambda;
+	int xpbd_iterations = 1;
+
+	// self collision: particles closer than 2 * collision_radius that aren't
+	// joined by a spring get pushed apart. the hash is rebuilt every substep,
+	// its cell defaults to twice the contact distance
+	bool self_collision = false;
+	float collision_radius = 5.0f;
+	SpatialHash hash;
+	struct {
+		AlignedVec<float> dx, dy, dz;
+	} contact;
+
+	// static colliders resolved after every substep. particles are culled in
+	// index blocks, cloth rows keep a block spatially tight so its box is a
+	// cheap broadphase. the view is the packed COLLIDER_STRIDE list for js
+	static constexpr std::size_t COLLIDER_BLOCK = 64;
+	std::vector<Collider> colliders;
+	AlignedVec<float> sdf_pool;
+	AlignedVec<float> collider_view;
+
+	// sleeping, per SLEEP_TILE^2 tile of the create_cloth grid. a tile whose
+	// mean kinetic energy per free particle stays under energy for steps
+	// steps in a row stops and turns frozen, the solvers then treat it like
+	// pinned and the per particle passes only walk the spans of awake tiles.
+	// a moving neighbour tile (above the same threshold) wakes it at the end
+	// of a step, pokes from js wake it right away
+	static constexpr int SLEEP_TILE = 8;
+	static constexpr std::uint32_t SLEEP_SPAN = 256;
+	struct {
+		bool enabled = false;
+		float energy = 0.0f;
+		int steps = 30;
+		int grid_w = 0, grid_h = 0; // 0 once the particles aren't a grid
+		int tiles_x = 0, tiles_y = 0;
+		int asleep_count = 0;
+		std::vector<int> still; // steps in a row under the threshold
+		std::vector<std::uint8_t> asleep;
+		std::vector<float> tile_energy;
+		// awake [begin, end) pieces, at most SLEEP_SPAN long
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> spans;
+		std::vector<int> wake, fall; // update_sleep's scratch
+	} sleep;
+
+public:
+	PhysicsWorld() {
+		particles.reserve(1000);
+		springs.reserve(3000);
+		view.reserve(1000 * VIEW_STRIDE);
+		// the old hard-coded floor
+		add_plane(0.0f, -1.0f, 0.0f, -900.0f);
+	}
+	void set_fixed_dt(float dt) {
+		fixed_dt = std::max(1e-4f, dt);
+	}
+	void set_max_steps(int n) {
+		max_steps = std::max(1, n);
+	}
+	auto get_alpha() const -> float {
+		return alpha;
+	}
+
+	void set_solver(int type) {
+		current_solver = static_cast<SolverType>(type);
+	}
+
+	void set_pinned(int i, bool pin) {
+		if (i >= 0 && std::size_t(i) < particles.size()) {
+			particles.pinned[i] = pin ? 1.0f : 0.0f;
+			particles.frozen[i] = pin ? 1.0f : 0.0f;
+			particles.set_old_pos(i, particles.pos(i));
+			adaptive.bound_dirty = true;
+			wake_around(i);
+		}
+	}
+
+	void set_use_simd(bool v) {
+		use_simd = v;
+	}
+
+	void set_cg_params(int max_iters, float tolerance) {
+		cg.max_iters = std::max(1, max_iters);
+		cg.tolerance = std::max(1e-8f, tolerance);
+	}
+	auto get_cg_iterations() const -> int {
+		return cg.last_iters;
+	}
+
+	// constraint passes per substep for SOLVER_XPBD. with enough substeps one
+	// is usually plenty
+	void set_xpbd_iterations(int n) {
+		xpbd_iterations = std::max(1, n);
+	}
+
+	void set_self_collision(bool v) {
+		self_collision = v;
+	}
+	void set_collision_radius(float r) {
+		collision_radius = std::max(0.0f, r);
+	}
+	// 0 for either means automatic: cell = 4 * radius, table = 2 * particles.
+	// cells smaller than that are bumped up to it
+	void set_hash_params(float cell_size, int table_size) {
+		hash.configure(cell_size, table_size);
+	}
+
+	// colliders live in sim space like create_cloth, the ids are indices and
+	// stay valid until clear_colliders
+	auto add_sphere(float x, float y, float z, float r) -> int {
+		Collider c;
+		c.type = COLLIDER_SPHERE;
+		c.a = {x, y, z};
+		c.radius = r;
+		return add_collider(c);
+	}
+	auto add_capsule(float ax, float ay, float az, float bx, float by, float bz, float r)
+	    -> int {
+		Collider c;
+		c.type = COLLIDER_CAPSULE;
+		c.a = {ax, ay, az};
+		c.b = {bx, by, bz};
+		c.radius = r;
+		return add_collider(c);
+	}
+	// keeps particles at dot(n, x) >= offset
+	auto add_plane(float nx, float ny, float nz, float offset) -> int {
+		Collider c;
+		c.type = COLLIDER_PLANE;
+		const float len = Vec3{nx, ny, nz}.length();
+		c.a = len > 0.0f ? Vec3{nx, ny, nz} * (1.0f / len) : Vec3{0, -1, 0};
+		c.offset = offset;
+		return add_collider(c);
+	}
+	// the values start at SDF_EMPTY, fill them through get_sdf_ptr
+	auto add_sdf_grid(float ox, float oy, float oz, int nx, int ny, int nz, float cell)
+	    -> int {
+		Collider c;
+		c.type = COLLIDER_SDF;
+		c.a = {ox, oy, oz};
+		c.nx = std::max(nx, 2);
+		c.ny = std::max(ny, 2);
+		c.nz = std::max(nz, 2);
+		c.offset = std::max(cell, 1e-6f);
+		c.sdf_first = sdf_pool.size();
+		sdf_pool.resize(sdf_pool.size() + std::size_t(c.nx) * c.ny * c.nz, SDF_EMPTY);
+		return add_collider(c);
+	}
+	// nx * ny * nz floats, x fastest. moves when another grid is added
+	auto get_sdf_ptr(int id) const -> uintptr_t {
+		if (id < 0 || id >= int(colliders.size()) || colliders[id].type != COLLIDER_SDF)
+			return 0;
+		return (uintptr_t)(sdf_pool.data() + colliders[id].sdf_first);
+	}
+	auto get_sdf_pool_ptr() const -> uintptr_t {
+		return (uintptr_t)sdf_pool.data();
+	}
+	auto get_sdf_pool_size() const -> int {
+		return sdf_pool.size();
+	}
+	// moves a (or both capsule ends by the same amount). planes move along
+	// their normal to pass through the point
+	void set_collider_pos(int id, float x, float y, float z) {
+		if (id < 0 || id >= int(colliders.size()))
+			return;
+		Collider &c = colliders[id];
+		const Vec3 p{x, y, z};
+		const Aabb before = c.bounds();
+		if (c.type == COLLIDER_PLANE) {
+			c.offset = c.a.dot(p);
+		} else {
+			c.b = c.b + (p - c.a);
+			c.a = p;
+		}
+		c.pack(&collider_view[id * COLLIDER_STRIDE]);
+		// whatever it left or moved into
+		const Aabb after = c.bounds();
+		wake_box({Vec3{std::min(before.lo.x, after.lo.x), std::min(before.lo.y, after.lo.y),
+		               std::min(before.lo.z, after.lo.z)},
+		          Vec3{std::max(before.hi.x, after.hi.x), std::max(before.hi.y, after.hi.y),
+		               std::max(before.hi.z, after.hi.z)}});
+	}
+	void set_collider_material(int id, float friction, float restitution) {
+		if (id < 0 || id >= int(colliders.size()))
+			return;
+		colliders[id].friction = std::clamp(friction, 0.0f, 1.0f);
+		colliders[id].restitution = std::clamp(restitution, 0.0f, 1.0f);
+		colliders[id].pack(&collider_view[id * COLLIDER_STRIDE]);
+	}
+	// removes the default floor as well
+	void clear_colliders() {
+		wake_all();
+		colliders.clear();
+		sdf_pool.clear();
+		collider_view.clear();
+	}
+	auto get_collider_ptr() const -> uintptr_t {
+		return (uintptr_t)collider_view.data();
+	}
+	auto get_collider_count() const -> int {
+		return colliders.size();
+	}
+
+	void set_thread_count(int n) {
+		pool.resize(n);
+	}
+	auto get_thread_count() const -> int {
+		return pool.size();
+	}
+	// with the same build, snapshot and sequence of calls, stepping then
+	// gives the same bits on any thread count. the only reduction that
+	// depends on the partition is the implicit solver's cg, everything else is
+	// per particle or per batch already
+	void set_deterministic(bool v) {
+		deterministic = v;
+	}
+
+	// the whole simulation state: particles, topology, colliders, sleeping
+	// and every parameter. scratch (cg vectors, hash, rk copies) is rebuilt
+	// by the next step, the thread count is left alone
+	auto get_snapshot_size() -> int {
+		std::size_t size = sizeof(SnapshotHeader) + sizeof(SnapshotParams);
+		for_each_snapshot_array([&](auto &v) {
+			size += 4 + padded(v.size() * sizeof(v[0]));
+		});
+		return size;
+	}
+	// writes into the caller's buffer (e.g. get_upload_ptr), returns the
+	// bytes written or 0 if capacity is too small. nothing is allocated
+	auto save_snapshot(uintptr_t ptr, int capacity) -> int {
+		const std::uint32_t size = get_snapshot_size();
+		if (capacity < 0 || std::uint32_t(capacity) < size)
+			return 0;
+		auto *out = reinterpret_cast<std::uint8_t *>(ptr);
+		const SnapshotHeader header{SNAPSHOT_MAGIC, SNAPSHOT_VERSION, snapshot_layout(), size};
+		const SnapshotParams params = snapshot_params();
+		std::memcpy(out, &header, sizeof header);
+		std::memcpy(out + sizeof header, &params, sizeof params);
+		out += sizeof header + sizeof params;
+		for_each_snapshot_array([&](auto &v) {
+			const std::uint32_t count = v.size();
+			const std::size_t bytes = count * sizeof(v[0]);
+			std::memcpy(out, &count, 4);
+			if (bytes > 0)
+				std::memcpy(out + 4, v.data(), bytes);
+			std::memset(out + 4 + bytes, 0, padded(bytes) - bytes);
+			out += 4 + padded(bytes);
+		});
+		return size;
+	}
+	// false (and nothing touched) unless ptr holds a whole snapshot from this
+	// build. the arrays only reallocate when their size changes, so going back
+	// to a snapshot of the same cloth is a run of memcpys and a csr rebuild
+	auto restore_snapshot(uintptr_t ptr, int size) -> bool {
+		const auto *in = reinterpret_cast<const std::uint8_t *>(ptr);
+		const std::size_t fixed = sizeof(SnapshotHeader) + sizeof(SnapshotParams);
+		if (size < 0 || std::size_t(size) < fixed)
+			return false;
+		SnapshotHeader header;
+		std::memcpy(&header, in, sizeof header);
+		if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION ||
+		    header.layout != snapshot_layout() || header.size != std::uint32_t(size))
+			return false;
+		// walk the counts first so a truncated buffer fails before any change
+		bool ok = true;
+		std::size_t at = fixed;
+		for_each_snapshot_array([&](auto &v) {
+			std::uint32_t count = 0;
+			if (ok && at + 4 <= std::size_t(size))
+				std::memcpy(&count, in + at, 4);
+			else
+				ok = false;
+			at += 4 + padded(std::size_t(count) * sizeof(v[0]));
+		});
+		if (!ok || at != std::size_t(size))
+			return false;
+
+		SnapshotParams params;
+		std::memcpy(&params, in + sizeof header, sizeof params);
+		apply_snapshot_params(params);
+		at = fixed;
+		for_each_snapshot_array([&](auto &v) {
+			std::uint32_t count;
+			std::memcpy(&count, in + at, 4);
+			v.resize(count);
+			if (count > 0)
+				std::memcpy(v.data(), in + at + 4, count * sizeof(v[0]));
+			at += 4 + padded(count * sizeof(v[0]));
+		});
+		build_csr();
+		collider_view.resize(colliders.size() * COLLIDER_STRIDE);
+		for (std::size_t c = 0; c < colliders.size(); ++c)
+			colliders[c].pack(&collider_view[c * COLLIDER_STRIDE]);
+		build_spans();
+		export_view();
+		return true;
+	}
+
+	// the Profiler stats view (STATS_SIZE floats), refreshed by every export.
+	// all zero unless built with SIM_PROFILE
+	auto get_stats_ptr() const -> uintptr_t {
+		return (uintptr_t)profile.stats();
+	}
+	auto has_profiler() const -> bool {
+		return Profiler::enabled;
+	}
+
+	auto has_simd() const -> bool {
+#ifdef __wasm_simd128__
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void update(float frame_dt) {
+		advance(frame_dt);
+		export_view();
+	}
+	// update without the export, for WorldBatch and SimHost which write the
+	// views into their own buffers. returns the steps it ran
+	auto advance(float frame_dt) -> int {
+		profile.begin_frame();
+		accumulator += std::max(0.0f, frame_dt);
+
+		int steps = 0;
+		while (accumulator >= fixed_dt && steps < max_steps) {
+			snapshot_prev();
+			step(fixed_dt);
+			accumulator -= fixed_dt;
+			++steps;
+		}
+		// out of budget, drop the backlog instead of paying it off later
+		if (accumulator >= fixed_dt)
+			accumulator = std::fmod(accumulator, fixed_dt);
+
+		alpha = accumulator / fixed_dt;
+		profile.count(COUNTER_STEPS, steps);
+		if constexpr (Profiler::enabled)
+			count_skipped();
+		return steps;
+	}
+	// the interpolated view (see export_view) written to out, which holds
+	// VIEW_STRIDE floats per particle
+	void export_view_to(float *out) {
+		const std::size_t n = particles.size();
+		if (prev.px.size() != n)
+			snapshot_prev();
+		auto timer = profile.time(PHASE_EXPORT);
+		const float t = alpha;
+		pool.parallel_for(n, [&](std::size_t b, std::size_t e) {
+			const auto &P = particles;
+			float *o = out + b * VIEW_STRIDE;
+			for (std::size_t i = b; i < e; ++i, o += VIEW_STRIDE) {
+				o[VIEW_X] = prev.px[i] + (P.px[i] - prev.px[i]) * t;
+				o[VIEW_Y] = -(prev.py[i] + (P.py[i] - prev.py[i]) * t);
+				o[VIEW_Z] = prev.pz[i] + (P.pz[i] - prev.pz[i]) * t;
+				o[VIEW_PINNED] = P.pinned[i];
+			}
+		});
+		profile.end_frame();
+	}
+	void step(float dt) {
+		int steps = sub_steps;
+		// the adaptive count covers long steps itself
+		if (adaptive.max_steps > 0)
+			steps = choose_sub_steps(dt);
+		else
+			dt = std::min(dt, 0.05f);
+		float sub_dt = dt / steps;
+		adaptive.rate.store(0.0f, std::memory_order_relaxed);
+		adaptive.last_steps = steps;
+		profile.count(COUNTER_SUB_STEPS, steps);
+
+		// the solver is resolved once per step, every substep is a direct call
+		// into its specialization. whatever the phases below don't claim is
+		// the integrator's
+		const SubstepFn substep = substep_for(current_solver);
+		auto timer = profile.time(PHASE_INTEGRATE);
+		for (int i = 0; i < steps; ++i)
+			(this->*substep)(sub_dt);
+
+		adaptive.observed = adaptive.rate.load(std::memory_order_relaxed);
+		auto upkeep = profile.time(PHASE_UPKEEP);
+		tear_springs();
+		update_sleep();
+	}
+
+	void set_gravity(float x, float y, float z) {
+		gravity = {x, y, z};
+		wake_all();
+	}
+	void set_wind(float x, float y, float z) {
+		wind = {x, y, z};
+		wake_all();
+	}
+	void set_damping(float d) {
+		global_damping = d;
+	}
+	void set_sub_steps(int steps) {
+		sub_steps = std::max(1, steps);
+	}
+	// max_steps 0 goes back to the fixed set_sub_steps count
+	void set_adaptive_sub_steps(int min_steps, int max_steps, float courant) {
+		adaptive.min_steps = std::max(1, min_steps);
+		adaptive.max_steps = max_steps > 0 ? std::max(adaptive.min_steps, max_steps) : 0;
+		adaptive.courant = std::clamp(courant, 0.01f, 1.0f);
+	}
+	// substeps the last step ran with
+	auto get_sub_steps() const -> int {
+		return adaptive.last_steps;
+	}
+
+	void set_mass(float m) {
+		m = std::max(0.1f, m);
+		if (uniform.mass_set && uniform.mass == m)
+			return;
+		uniform.mass = m;
+		uniform.mass_set = true;
+		adaptive.bound_dirty = true;
+		std::fill(particles.mass.begin(), particles.mass.end(), m);
+		std::fill(particles.inv_mass.begin(), particles.inv_mass.end(), 1.0f / m);
+	}
+
+	void set_spring_params(float k, float damp) {
+		if (uniform.springs_set && uniform.k == k && uniform.damp == damp)
+			return;
+		uniform.k = k;
+		uniform.damp = damp;
+		uniform.springs_set = true;
+		wake_all();
+		adaptive.bound_dirty = true;
+		for_each_spring([&](Spring &s) {
+			s.k = k;
+			s.damp = damp;
+		});
+		for (auto &e : adj_data) {
+			e.k = k;
+			e.damp = damp;
+		}
+	}
+
+	void add_particle(float x, float y, float z, float m, bool pin) {
+		// not a grid anymore, the tiles go
+		wake_all();
+		sleep.grid_w = sleep.grid_h = 0;
+		uniform.mass_set = uniform.mass_set && m == uniform.mass;
+		particles.push({x, y, z}, m, pin);
+	}
+
+	// scratch the *_range calls below read from or write to, at least floats
+	// long. js fills it through the returned pointer, which stays put until a
+	// longer one is asked for
+	auto get_upload_ptr(int floats) -> uintptr_t {
+		if (upload.size() < std::size_t(std::max(0, floats)))
+			upload.resize(floats);
+		return (uintptr_t)upload.data();
+	}
+	// one float per particle from the upload, nonzero pins
+	void set_pinned_range(int first, int count) {
+		auto [b, e] = upload_range(first, count, particles.size(), 1);
+		for (int i = b; i < e; ++i) {
+			const bool pin = upload[i - b] != 0.0f;
+			particles.pinned[i] = pin ? 1.0f : 0.0f;
+			particles.frozen[i] = pin ? 1.0f : 0.0f;
+			particles.set_old_pos(i, particles.pos(i));
+		}
+		adaptive.bound_dirty = true;
+		wake_range(b, e);
+	}
+	// 1.0 / 0.0 per particle into the upload
+	void get_pinned_range(int first, int count) {
+		auto [b, e] = clamp_range(first, count, particles.size());
+		get_upload_ptr(e - b);
+		std::copy(particles.pinned.begin() + b, particles.pinned.begin() + e, upload.begin());
+	}
+	// set_particle_pos for a range, xyz per particle from the upload
+	void set_positions_range(int first, int count) {
+		auto [b, e] = upload_range(first, count, particles.size(), 3);
+		const bool blend = prev.px.size() == particles.size();
+		for (int i = b; i < e; ++i) {
+			const Vec3 p{upload[(i - b) * 3], upload[(i - b) * 3 + 1], upload[(i - b) * 3 + 2]};
+			particles.set_pos(i, p);
+			particles.set_old_pos(i, p);
+			if (blend) {
+				prev.px[i] = p.x;
+				prev.py[i] = p.y;
+				prev.pz[i] = p.z;
+			}
+		}
+		wake_range(b, e);
+	}
+	// one mass per particle from the upload, clamped like set_mass
+	void set_masses_range(int first, int count) {
+		auto [b, e] = upload_range(first, count, particles.size(), 1);
+		for (int i = b; i < e; ++i) {
+			const float m = std::max(0.1f, upload[i - b]);
+			particles.mass[i] = m;
+			particles.inv_mass[i] = 1.0f / m;
+		}
+		uniform.mass_set = false;
+		adaptive.bound_dirty = true;
+		wake_range(b, e);
+	}
+	// (k, damp) per spring from the upload, by get_s_ptr index. torn springs
+	// in the range keep k = damp = 0
+	void set_springs_range(int first, int count) {
+		auto [b, e] = upload_range(first, count, springs.size(), 2);
+		for (std::size_t batch = 0; batch < batch_ends.size(); ++batch) {
+			const int lo = std::max(b, batch_offsets[batch]);
+			const int hi = std::min(e, batch_ends[batch]);
+			for (int i = lo; i < hi; ++i) {
+				springs[i].k = upload[(i - b) * 2];
+				springs[i].damp = upload[(i - b) * 2 + 1];
+			}
+		}
+		uniform.springs_set = false;
+		build_csr();
+		wake_all();
+	}
+
+	void create_cloth(float sx, float sy, float sz, int w, int h, float sep,
+	                  float k, float damp) {
+		create_grid(sx, sy, sz, w, h, sep, sep, k, damp);
+	}
+	// create_cloth with its own spacing per axis, the coarse levels of a
+	// ClothLod stretch their cells to cover the same sheet
+	void create_grid(float sx, float sy, float sz, int w, int h, float sep_x,
+	                 float sep_y, float k, float damp) {
+		particles.clear();
+		springs.clear();
+
+		particles.reserve(w * h);
+		springs.reserve(std::size_t(w) * h * 4);
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				bool is_anchor = (y == 0 && (x == 0 || x == w - 1));
+
+				particles.push({sx + x * sep_x, sy - y * sep_y, sz}, 1.0f, is_anchor);
+			}
+		}
+		// grid colouring: every direction alternates on the axis it runs along,
+		// so 4 directions x 2 parities gives 8 race-free batches
+		auto &colors = build.colors;
+		colors.clear();
+		auto add_spring = [&](int p1, int p2, float len, int color) {
+			springs.push_back({p1, p2, len, k, damp, 0.0f});
+			colors.push_back(color);
+		};
+
+		const float diag = std::sqrt(sep_x * sep_x + sep_y * sep_y);
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				int i = y * w + x;
+
+				if (x > 0)
+					add_spring(i, i - 1, sep_x, 0 + (x & 1));
+				if (y > 0)
+					add_spring(i, i - w, sep_y, 2 + (y & 1));
+				if (x > 0 && y > 0)
+					add_spring(i, i - w - 1, diag, 4 + (y & 1));
+				if (x < w - 1 && y > 0)
+					add_spring(i, i - w + 1, diag, 6 + (y & 1));
+			}
+		}
+		build_batches(colors, 8);
+		reset_sleep(w, h);
+		uniform = {1.0f, k, damp, true, true};
+		// a new cloth of the same size would blend from the old one, and the
+		// old one's leftover time would step it right away
+		accumulator = 0.0f;
+		alpha = 1.0f;
+		snapshot_prev();
+		export_view();
+	}
+
+	// sizes the create_mesh input, then write vertex_count xyz floats to
+	// get_mesh_vertex_ptr and triangle_count * 3 indices to get_mesh_index_ptr
+	void begin_mesh(int vertex_count, int triangle_count) {
+		mesh_in.vertices.resize(std::size_t(std::max(0, vertex_count)) * 3);
+		mesh_in.indices.resize(std::size_t(std::max(0, triangle_count)) * 3);
+	}
+	auto get_mesh_vertex_ptr() const -> uintptr_t {
+		return (uintptr_t)mesh_in.vertices.data();
+	}
+	auto get_mesh_index_ptr() const -> uintptr_t {
+		return (uintptr_t)mesh_in.indices.data();
+	}
+	// replaces the cloth with the begin_mesh triangles. every triangle edge
+	// becomes one spring (structural, and shear for triangulated quads), and
+	// with bend_k > 0 the two corners across each edge shared by two triangles
+	// get a bend spring. vertices are in render space (y up), like getPPtr,
+	// none start pinned. triangles with an index out of range are skipped
+	void create_mesh(float k, float damp, float bend_k) {
+		const std::size_t n = mesh_in.vertices.size() / 3;
+		const std::size_t tris = mesh_in.indices.size() / 3;
+		particles.clear();
+		springs.clear();
+		particles.reserve(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			const float *v = &mesh_in.vertices[i * 3];
+			particles.push({v[0], -v[1], v[2]}, 1.0f, false);
+		}
+
+		// at most 3 edges and 1.5 bends per triangle, kept under half full
+		std::size_t cap = 64;
+		while (cap < tris * 9)
+			cap <<= 1;
+		const unsigned shift = 64 - std::countr_zero(cap);
+		constexpr std::uint64_t EMPTY = ~std::uint64_t{0};
+		build.keys.assign(cap, EMPTY);
+		build.spring.resize(cap);
+		build.opposite.clear();
+		springs.reserve(tris * (bend_k > 0.0f ? 3 : 2));
+		// slot of the edge, true if it was just inserted
+		auto insert = [&](std::uint32_t a, std::uint32_t b) -> std::pair<std::size_t, bool> {
+			const std::uint64_t key = std::uint64_t(std::min(a, b)) << 32 | std::max(a, b);
+			std::size_t slot = (key * 0x9e3779b97f4a7c15ull) >> shift;
+			while (build.keys[slot] != EMPTY) {
+				if (build.keys[slot] == key)
+					return {slot, false};
+				slot = (slot + 1) & (cap - 1);
+			}
+			build.keys[slot] = key;
+			build.spring[slot] = springs.size();
+			return {slot, true};
+		};
+		auto add_spring = [&](std::uint32_t a, std::uint32_t b, float stiff) {
+			const float len = (particles.pos(a) - particles.pos(b)).length();
+			springs.push_back({int(a), int(b), len, stiff, damp, 0.0f});
+		};
+
+		const std::uint32_t *idx = mesh_in.indices.data();
+		for (std::size_t t = 0; t < tris; ++t, idx += 3) {
+			if (idx[0] >= n || idx[1] >= n || idx[2] >= n)
+				continue;
+			for (int c = 0; c < 3; ++c) {
+				const std::uint32_t a = idx[c], b = idx[(c + 1) % 3];
+				const std::int32_t opp = idx[(c + 2) % 3];
+				if (a == b)
+					continue;
+				auto [slot, fresh] = insert(a, b);
+				if (fresh) {
+					add_spring(a, b, k);
+					build.opposite.push_back(opp);
+					build.opposite.push_back(-1);
+					continue;
+				}
+				// non-manifold edges keep their first two triangles
+				std::int32_t *o = &build.opposite[build.spring[slot] * 2];
+				if (o[1] < 0 && o[0] != opp)
+					o[1] = opp;
+			}
+		}
+		// bends go through the same set, so a pair that is already an edge
+		// (or another edge's bend) doesn't get a second spring
+		const std::size_t edges = springs.size();
+		for (std::size_t e = 0; bend_k > 0.0f && e < edges; ++e) {
+			const std::int32_t o0 = build.opposite[e * 2], o1 = build.opposite[e * 2 + 1];
+			if (o1 >= 0 && o0 != o1 && insert(o0, o1).second)
+				add_spring(o0, o1, bend_k);
+		}
+
+		build_batches(build.colors, color_springs());
+		reset_sleep(0, 0);
+		uniform = {1.0f, k, damp, true, bend_k <= 0.0f || springs.size() == edges};
+		// a mesh with the old vertex count would blend from the old positions
+		snapshot_prev();
+		export_view();
+	}
+
+	auto get_p_ptr() const -> uintptr_t {
+		return (uintptr_t)view.data();
+	}
+	auto get_s_ptr() const -> uintptr_t {
+		return (uintptr_t)springs.data();
+	}
+	auto get_p_count() const -> int {
+		return particles.size();
+	}
+	auto get_s_count() const -> int {
+		return springs.size();
+	}
+	// create_cloth grid size, 0 once the particles aren't a grid anymore
+	auto get_grid_w() const -> int {
+		return has_tiles() ? sleep.grid_w : 0;
+	}
+	auto get_grid_h() const -> int {
+		return has_tiles() ? sleep.grid_h : 0;
+	}
+
+	// takes over the state of src, the same sheet as another create_grid at
+	// a different resolution (see ClothLod). every free particle gets src's
+	// position, velocity and interpolation start sampled bilinearly at its
+	// spot on the sheet, which is plain injection when src is the finer one.
+	// pinned particles keep theirs. the accumulator comes along, so the
+	// switch doesn't skip or repeat a step
+	void resample_from(const PhysicsWorld &src) {
+		if (!has_tiles() || !src.has_tiles())
+			return;
+		const int w = sleep.grid_w, h = sleep.grid_h;
+		const int sw = src.sleep.grid_w, sh = src.sleep.grid_h;
+		const float scale_x = w > 1 ? float(sw - 1) / (w - 1) : 0.0f;
+		const float scale_y = h > 1 ? float(sh - 1) / (h - 1) : 0.0f;
+		const bool blend = src.prev.px.size() == src.particles.size();
+		const auto &S = src.particles;
+		auto &P = particles;
+		// the verlet solvers take the velocity from the old position, one of
+		// our substeps back
+		const int steps = adaptive.max_steps > 0 ? adaptive.last_steps : sub_steps;
+		const float sub_dt = fixed_dt / std::max(1, steps);
+		snapshot_prev();
+		for (int y = 0; y < h; ++y) {
+			const float v = y * scale_y;
+			const int y0 = std::min(int(v), std::max(0, sh - 2));
+			const float ty = v - y0;
+			const std::size_t down = sh > 1 ? sw : 0;
+			for (int x = 0; x < w; ++x) {
+				const std::size_t i = std::size_t(y) * w + x;
+				if (P.is_pinned(i))
+					continue;
+				const float u = x * scale_x;
+				const int x0 = std::min(int(u), std::max(0, sw - 2));
+				const float tx = u - x0;
+				const std::size_t a = std::size_t(y0) * sw + x0;
+				const std::size_t b = a + (sw > 1 ? 1 : 0);
+				auto sample = [&](const AlignedVec<float> &f) {
+					const float top = f[a] + (f[b] - f[a]) * tx;
+					const float bottom = f[a + down] + (f[b + down] - f[a + down]) * tx;
+					return top + (bottom - top) * ty;
+				};
+				const Vec3 pos{sample(S.px), sample(S.py), sample(S.pz)};
+				const Vec3 vel{sample(S.vx), sample(S.vy), sample(S.vz)};
+				P.set_pos(i, pos);
+				P.set_vel(i, vel);
+				P.set_old_pos(i, pos - vel * sub_dt);
+				P.prev_dt[i] = sub_dt;
+				P.set_acc(i, {0, 0, 0});
+				if (blend) {
+					prev.px[i] = sample(src.prev.px);
+					prev.py[i] = sample(src.prev.py);
+					prev.pz[i] = sample(src.prev.pz);
+				} else {
+					prev.px[i] = pos.x;
+					prev.py[i] = pos.y;
+					prev.pz[i] = pos.z;
+				}
+			}
+		}
+		accumulator = src.accumulator;
+		alpha = src.alpha;
+		wake_all();
+	}
+
+	void set_particle_pos(int i, float x, float y, float z) {
+		if (i >= 0 && std::size_t(i) < particles.size()) {
+			particles.set_pos(i, {x, y, z});
+			particles.set_old_pos(i, {x, y, z});
+			wake_around(i);
+			// moved by hand, don't interpolate towards it
+			if (std::size_t(i) < prev.px.size()) {
+				prev.px[i] = x;
+				prev.py[i] = y;
+				prev.pz[i] = z;
+			}
+		}
+	}
+
+	bool is_pinned(int i) {
+		if (i >= 0 && std::size_t(i) < particles.size())
+			return particles.is_pinned(i);
+		return false;
+	}
+
+	// nearest particle to a render space ray (direction normalized) that lies
+	// within radius of it, closest to the origin wins. -1 when nothing is hit
+	auto pick_particle(float ox, float oy, float oz, float dx, float dy, float dz,
+	                   float radius) -> int {
+		struct Hit {
+			float t = INFINITY;
+			int idx = -1;
+		};
+		const int chunks = pool.size();
+		std::vector<Hit> hits(chunks);
+		const Vec3 o{ox, -oy, oz};
+		const Vec3 d{dx, -dy, dz};
+		const float r_sq = radius * radius;
+
+		pool.parallel_chunks(particles.size(), chunks,
+		                     [&](int c, std::size_t b, std::size_t e) {
+			Hit best;
+			for (std::size_t i = b; i < e; ++i) {
+				Vec3 rel = particles.pos(i) - o;
+				float t = rel.x * d.x + rel.y * d.y + rel.z * d.z;
+				if (t < 0.0f || t >= best.t)
+					continue;
+				float dist_sq = rel.x * rel.x + rel.y * rel.y + rel.z * rel.z - t * t;
+				if (dist_sq <= r_sq)
+					best = {t, static_cast<int>(i)};
+			}
+			hits[c] = best;
+		});
+
+		Hit best;
+		for (const auto &h : hits)
+			if (h.t < best.t)
+				best = h;
+		if (best.idx >= 0)
+			wake_around(best.idx);
+		return best.idx;
+	}
+
+	// csr topology, see adj_offsets. counts are exposed so js can size typed
+	// array views straight over the heap
+	auto get_adj_offsets_ptr() const -> uintptr_t {
+		return (uintptr_t)adj_offsets.data();
+	}
+	auto get_adj_indices_ptr() const -> uintptr_t {
+		return (uintptr_t)adj_indices.data();
+	}
+	auto get_adj_data_ptr() const -> uintptr_t {
+		return (uintptr_t)adj_data.data();
+	}
+	auto get_adj_count() const -> int {
+		return adj_indices.size();
+	}
+
+	auto get_batch_count() const -> int {
+		return static_cast<int>(batch_offsets.size()) - 1;
+	}
+	auto get_batch_end(int b) const -> int {
+		return b >= 0 && b < int(batch_ends.size()) ? batch_ends[b] : 0;
+	}
+
+	// every live spring breaks once stretched past strain * (1 + jitter * u),
+	// u in [-1, 1] hashed from the spring's endpoints so the same cloth tears
+	// the same way. strain 0 turns tearing off
+	void set_tear_strain(float strain, float jitter) {
+		tearing = strain > 0.0f;
+		for_each_spring([&](Spring &s) {
+			std::uint32_t h = std::uint32_t(s.p1) * 2654435761u ^ std::uint32_t(s.p2) * 40503u;
+			h ^= h >> 15;
+			h *= 2246822519u;
+			h ^= h >> 13;
+			const float u = float(h & 0xffff) / 32767.5f - 1.0f;
+			s.tear = strain > 0.0f ? std::max(0.0f, strain * (1.0f + jitter * u)) : 0.0f;
+		});
+		build_csr();
+	}
+	// threshold of one live spring by its index in get_s_ptr, 0 makes it
+	// unbreakable. indices move when springs tear
+	void set_spring_tear(int i, float strain) {
+		bool live = false;
+		for (std::size_t b = 0; b < batch_ends.size(); ++b)
+			live = live || (i >= batch_offsets[b] && i < batch_ends[b]);
+		if (!live)
+			return;
+		Spring &sp = springs[i];
+		sp.tear = std::max(0.0f, strain);
+		tearing = tearing || sp.tear > 0.0f;
+		// patch both csr entries instead of rebuilding
+		auto patch = [&](int row, int other) {
+			for (std::uint32_t e = adj_offsets[row]; e < adj_offsets[row + 1]; ++e)
+				if (adj_indices[e] == std::uint32_t(other))
+					adj_data[e].tear = sp.tear;
+		};
+		patch(sp.p1, sp.p2);
+		patch(sp.p2, sp.p1);
+	}
+	auto get_broken_count() const -> int {
+		return broken_springs;
+	}
+
+	// tiles sleep once their mean kinetic energy per free particle stays
+	// under energy for steps steps. energy 0 turns sleeping off and wakes
+	// everything
+	void set_sleep_threshold(float energy, int steps) {
+		sleep.energy = std::max(0.0f, energy);
+		sleep.steps = std::max(1, steps);
+		sleep.enabled = sleep.energy > 0.0f;
+		if (!sleep.enabled)
+			wake_all();
+	}
+	auto get_sleeping_tiles() const -> int {
+		return sleep.asleep_count;
+	}
+
+	// kinetic + spring potential + potential of the constant external force
+	// (gravity and wind), for drift checks. pinned particles don't count
+	auto energy() const -> double {
+		const auto &P = particles;
+		const Vec3 f = gravity + wind;
+		double e = 0.0;
+		for (std::size_t i = 0; i < P.size(); ++i) {
+			if (P.is_pinned(i))
+				continue;
+			Vec3 v = P.vel(i);
+			e += 0.5 * P.mass[i] * v.dot(v);
+			e -= P.mass[i] * f.dot(P.pos(i));
+		}
+		for_each_spring([&](const Spring &s) {
+			double stretch = (P.pos(s.p1) - P.pos(s.p2)).length() - s.rest_len;
+			e += 0.5 * s.k * stretch * stretch;
+		});
+		return e;
+	}
+
+private:
+	static constexpr std::size_t padded(std::size_t bytes) {
+		return (bytes + 3) & ~std::size_t{3};
+	}
+	static constexpr std::uint32_t snapshot_layout() {
+		return std::uint32_t(sizeof(SnapshotParams) | sizeof(Collider) << 8 |
+		                     sizeof(Spring) << 16 | sizeof(void *) << 24);
+	}
+	// every array save_snapshot writes, in file order. the csr and the packed
+	// collider list are rebuilt from springs / colliders on restore, they're
+	// half the size otherwise
+	template <class F> void for_each_snapshot_array(F &&f) {
+		particles.for_each_stream(f);
+		for (auto *v : {&prev.px, &prev.py, &prev.pz})
+			f(*v);
+		f(springs);
+		f(batch_offsets);
+		f(batch_ends);
+		f(colliders);
+		f(sdf_pool);
+		f(sleep.still);
+		f(sleep.asleep);
+		f(sleep.tile_energy);
+	}
+	auto snapshot_params() const -> SnapshotParams {
+		return {
+		    gravity, wind, global_damping, sub_steps,
+		    adaptive.min_steps, adaptive.max_steps, adaptive.courant,
+		    adaptive.observed, adaptive.last_steps,
+		    int(current_solver), fixed_dt, accumulator, alpha, max_steps,
+		    use_simd, cg.max_iters, cg.tolerance, cg.last_iters, xpbd_iterations,
+		    self_collision, collision_radius, hash.requested_cell_size(),
+		    hash.requested_table_size(), tearing, broken_springs,
+		    sleep.enabled, sleep.energy, sleep.steps, sleep.grid_w, sleep.grid_h,
+		    sleep.tiles_x, sleep.tiles_y, sleep.asleep_count,
+		    uniform.mass, uniform.k, uniform.damp, uniform.mass_set,
+		    uniform.springs_set, deterministic,
+		};
+	}
+	void apply_snapshot_params(const SnapshotParams &p) {
+		gravity = p.gravity;
+		wind = p.wind;
+		global_damping = p.global_damping;
+		sub_steps = p.sub_steps;
+		adaptive.min_steps = p.adaptive_min;
+		adaptive.max_steps = p.adaptive_max;
+		adaptive.courant = p.adaptive_courant;
+		adaptive.observed = p.adaptive_observed;
+		adaptive.last_steps = p.adaptive_last;
+		current_solver = static_cast<SolverType>(p.solver);
+		fixed_dt = p.fixed_dt;
+		accumulator = p.accumulator;
+		alpha = p.alpha;
+		max_steps = p.max_steps;
+		use_simd = p.use_simd;
+		cg.max_iters = p.cg_max_iters;
+		cg.tolerance = p.cg_tolerance;
+		cg.last_iters = p.cg_last_iters;
+		xpbd_iterations = p.xpbd_iterations;
+		self_collision = p.self_collision;
+		collision_radius = p.collision_radius;
+		hash.configure(p.hash_cell, p.hash_table);
+		tearing = p.tearing;
+		broken_springs = p.broken_springs;
+		sleep.enabled = p.sleep_enabled;
+		sleep.energy = p.sleep_energy;
+		sleep.steps = p.sleep_steps;
+		sleep.grid_w = p.grid_w;
+		sleep.grid_h = p.grid_h;
+		sleep.tiles_x = p.tiles_x;
+		sleep.tiles_y = p.tiles_y;
+		sleep.asleep_count = p.asleep_count;
+		uniform = {p.uniform_mass, p.uniform_k, p.uniform_damp,
+		           p.uniform_mass_set != 0, p.uniform_springs_set != 0};
+		deterministic = p.deterministic;
+	}
+
+	static auto clamp_range(int first, int count, std::size_t size) -> std::pair<int, int> {
+		const int b = std::clamp(first, 0, int(size));
+		return {b, b + std::clamp(count, 0, int(size) - b)};
+	}
+	// clamp_range that also stops where the upload runs out
+	auto upload_range(int first, int count, std::size_t size, int stride) const
+	    -> std::pair<int, int> {
+		auto [b, e] = clamp_range(first, count, size);
+		return {b, std::min(e, b + int(upload.size() / stride))};
+	}
+
+	// stable counting sort of springs by colour, then rebuild everything that
+	// refers to springs by index
+	void build_batches(const std::vector<int> &colors, int color_count) {
+		batch_offsets.assign(color_count + 1, 0);
+		for (int c : colors)
+			++batch_offsets[c + 1];
+		for (int c = 0; c < color_count; ++c)
+			batch_offsets[c + 1] += batch_offsets[c];
+
+		auto &sorted = build.sorted;
+		auto &cursor = build.cursor;
+		sorted.resize(springs.size());
+		cursor.assign(batch_offsets.begin(), batch_offsets.end() - 1);
+		for (std::size_t i = 0; i < springs.size(); ++i)
+			sorted[cursor[colors[i]]++] = springs[i];
+		springs.swap(sorted);
+		batch_ends.assign(batch_offsets.begin() + 1, batch_offsets.end());
+		broken_springs = 0;
+		tearing = false;
+
+		build_csr();
+	}
+
+	// greedy colouring into build.colors: every spring takes the lowest
+	// colour neither endpoint has yet, so at most 2 * max valence - 1 colours
+	// in one pass. the per particle masks grow 64 colours at a time when a
+	// valence needs it. returns the colour count
+	int color_springs() {
+		const std::size_t n = particles.size();
+		std::size_t words = 1;
+		build.masks.assign(n, 0);
+		build.colors.resize(springs.size());
+		int color_count = 0;
+		for (std::size_t s = 0; s < springs.size(); ++s) {
+			std::uint64_t *ma = &build.masks[springs[s].p1 * words];
+			std::uint64_t *mb = &build.masks[springs[s].p2 * words];
+			std::size_t w = 0;
+			while (w < words && (ma[w] | mb[w]) == ~std::uint64_t{0})
+				++w;
+			if (w == words) {
+				std::vector<std::uint64_t> wide(n * (words + 1), 0);
+				for (std::size_t i = 0; i < n; ++i)
+					std::copy_n(&build.masks[i * words], words, &wide[i * (words + 1)]);
+				build.masks.swap(wide);
+				++words;
+				ma = &build.masks[springs[s].p1 * words];
+				mb = &build.masks[springs[s].p2 * words];
+			}
+			const int bit = std::countr_one(ma[w] | mb[w]);
+			ma[w] |= std::uint64_t{1} << bit;
+			mb[w] |= std::uint64_t{1} << bit;
+			build.colors[s] = int(w) * 64 + bit;
+			color_count = std::max(color_count, build.colors[s] + 1);
+		}
+		return color_count;
+	}
+
+	// live springs only. after a tear the arrays only shrink, so the
+	// pointers js holds stay valid
+	void build_csr() {
+		adaptive.bound_dirty = true;
+		const std::size_t n = particles.size();
+		adj_offsets.assign(n + 1, 0);
+		for_each_spring([&](const Spring &sp) {
+			++adj_offsets[sp.p1 + 1];
+			++adj_offsets[sp.p2 + 1];
+		});
+		for (std::size_t i = 0; i < n; ++i)
+			adj_offsets[i + 1] += adj_offsets[i];
+
+		adj_indices.resize(adj_offsets[n]);
+		adj_data.resize(adj_offsets[n]);
+		auto &cursor = csr_cursor;
+		cursor.assign(adj_offsets.begin(), adj_offsets.end() - 1);
+		for_each_spring([&](const Spring &sp) {
+			const Edge e{sp.rest_len, sp.k, sp.damp, sp.tear};
+			adj_indices[cursor[sp.p1]] = sp.p2;
+			adj_data[cursor[sp.p1]++] = e;
+			adj_indices[cursor[sp.p2]] = sp.p1;
+			adj_data[cursor[sp.p2]++] = e;
+		});
+		torn.resize(batch_ends.size());
+	}
+
+	template <class F> void for_each_spring(F &&f) {
+		for (std::size_t b = 0; b < batch_ends.size(); ++b)
+			for (int i = batch_offsets[b]; i < batch_ends[b]; ++i)
+				f(springs[i]);
+	}
+	template <class F> void for_each_spring(F &&f) const {
+		for (std::size_t b = 0; b < batch_ends.size(); ++b)
+			for (int i = batch_offsets[b]; i < batch_ends[b]; ++i)
+				f(springs[i]);
+	}
+
+	// once per step, strain builds up over several substeps anyway. every
+	// batch is compacted on its own by swapping the torn spring with the
+	// batch's last live one, then the csr is rebuilt if anything went
+	void tear_springs() {
+		if (!tearing)
+			return;
+		const auto &P = particles;
+		std::fill(torn.begin(), torn.end(), 0);
+		pool.parallel_for(batch_ends.size(), [&](std::size_t b0, std::size_t b1) {
+			for (std::size_t b = b0; b < b1; ++b) {
+				int end = batch_ends[b];
+				for (int i = batch_offsets[b]; i < end;) {
+					const Spring &s = springs[i];
+					const float len = (P.pos(s.p1) - P.pos(s.p2)).length();
+					if (s.tear <= 0.0f || len <= s.rest_len * (1.0f + s.tear)) {
+						++i;
+						continue;
+					}
+					std::swap(springs[i], springs[--end]);
+					springs[end].k = 0.0f;
+					springs[end].damp = 0.0f;
+				}
+				torn[b] = batch_ends[b] - end;
+				batch_ends[b] = end;
+			}
+		});
+		int total = 0;
+		for (int t : torn)
+			total += t;
+		if (total == 0)
+			return;
+		broken_springs += total;
+		build_csr();
+	}
+
+	// once per solve_springs / xpbd_project range, the max doesn't depend on
+	// which thread got there first
+	void note_rate(float rate) {
+		float seen = adaptive.rate.load(std::memory_order_relaxed);
+		while (rate > seen &&
+		       !adaptive.rate.compare_exchange_weak(seen, rate, std::memory_order_relaxed)) {
+		}
+	}
+
+	// per row sum over the springs of k (inv_m_i + inv_m_j), the largest one
+	// bounds omega^2. pinned rows don't move and pinned neighbours add 0
+	void refresh_stiffness_bound() {
+		adaptive.bound_dirty = false;
+		const auto &P = particles;
+		const std::size_t n = P.size();
+		float k_max = 0.0f, d_max = 0.0f;
+		for (std::size_t i = 0; i < n; ++i) {
+			if (P.is_pinned(i))
+				continue;
+			float k = 0.0f, d = 0.0f;
+			for (std::uint32_t e = adj_offsets[i]; e < adj_offsets[i + 1]; ++e) {
+				const std::uint32_t j = adj_indices[e];
+				const float w = P.inv_mass[i] + (P.is_pinned(j) ? 0.0f : P.inv_mass[j]);
+				k += adj_data[e].k * w;
+				d += adj_data[e].damp * w;
+			}
+			k_max = std::max(k_max, k);
+			d_max = std::max(d_max, d);
+		}
+		adaptive.omega = std::sqrt(k_max);
+		adaptive.zeta = d_max;
+	}
+
+	int choose_sub_steps(float dt) {
+		if (adaptive.bound_dirty)
+			refresh_stiffness_bound();
+		// h omega the integrator stays stable up to on an undamped spring.
+		// explicit euler never quite is, and the rk solvers hold their
+		// neighbours at the substep start, so those get about what the old
+		// fixed default gave them in practice
+		float limit = 2.0f;
+		switch (current_solver) {
+		case SOLVER_EXPLICIT_EULER:
+		case SOLVER_RK2:
+		case SOLVER_RK4:
+			limit = 0.7f;
+			break;
+		case SOLVER_IMPLICIT_EULER:
+		case SOLVER_XPBD:
+			limit = INFINITY;
+			break;
+		default:
+			break;
+		}
+		float h = INFINITY;
+		if (adaptive.omega > 0.0f)
+			h = limit / adaptive.omega;
+		if (adaptive.zeta > 0.0f)
+			h = std::min(h, limit / adaptive.zeta);
+		if (adaptive.observed > 0.0f)
+			h = std::min(h, 1.0f / adaptive.observed);
+		h *= adaptive.courant;
+		const float n = std::isfinite(h) ? std::ceil(dt / h) : 1.0f;
+		return std::clamp(int(std::min(n, 1e6f)), adaptive.min_steps, adaptive.max_steps);
+	}
+
+	// f(begin, end) over the awake particles, in one parallel_for over the
+	// whole range while nothing sleeps
+	template <class F> void for_awake(F &&f) {
+		if (sleep.asleep_count == 0) {
+			pool.parallel_for(particles.size(), f);
+			return;
+		}
+		pool.parallel_for(sleep.spans.size(), [&](std::size_t b, std::size_t e) {
+			for (std::size_t s = b; s < e; ++s)
+				f(std::size_t(sleep.spans[s].first), std::size_t(sleep.spans[s].second));
+		}, 1024 / SLEEP_SPAN);
+	}
+
+	void reset_sleep(int w, int h) {
+		sleep.grid_w = w;
+		sleep.grid_h = h;
+		sleep.tiles_x = (w + SLEEP_TILE - 1) / SLEEP_TILE;
+		sleep.tiles_y = (h + SLEEP_TILE - 1) / SLEEP_TILE;
+		const std::size_t tiles = std::size_t(sleep.tiles_x) * sleep.tiles_y;
+		sleep.still.assign(tiles, 0);
+		sleep.asleep.assign(tiles, 0);
+		sleep.tile_energy.assign(tiles, 0.0f);
+		sleep.asleep_count = 0;
+		sleep.spans.clear();
+	}
+
+	[[nodiscard]] bool has_tiles() const {
+		return sleep.grid_w > 0 &&
+		       particles.size() == std::size_t(sleep.grid_w) * sleep.grid_h;
+	}
+	template <class F> void for_tile(int t, F &&f) const {
+		const int x0 = (t % sleep.tiles_x) * SLEEP_TILE;
+		const int y0 = (t / sleep.tiles_x) * SLEEP_TILE;
+		const int x1 = std::min(sleep.grid_w, x0 + SLEEP_TILE);
+		const int y1 = std::min(sleep.grid_h, y0 + SLEEP_TILE);
+		for (int y = y0; y < y1; ++y)
+			for (int x = x0; x < x1; ++x)
+				f(std::size_t(y) * sleep.grid_w + x);
+	}
+
+	// without touching the spans, callers rebuild them once they're done
+	bool wake_tile_only(int t) {
+		sleep.still[t] = 0;
+		if (!sleep.asleep[t])
+			return false;
+		sleep.asleep[t] = 0;
+		--sleep.asleep_count;
+		for_tile(t, [&](std::size_t i) { particles.frozen[i] = particles.pinned[i]; });
+		return true;
+	}
+	void wake_all() {
+		if (sleep.asleep_count == 0)
+			return;
+		for (std::size_t t = 0; t < sleep.asleep.size(); ++t)
+			wake_tile_only(t);
+		build_spans();
+	}
+	// the particle's tile and the ones around it, so springs across the
+	// border don't pull at frozen particles
+	void wake_around(int i) {
+		wake_range(i, i + 1);
+	}
+	// wake_around for every particle in [begin, end), spans rebuilt once
+	void wake_range(int begin, int end) {
+		if (sleep.asleep_count == 0 || !has_tiles() || begin < 0)
+			return;
+		bool changed = false;
+		for (int i = begin; i < end; ++i) {
+			const int tx = (i % sleep.grid_w) / SLEEP_TILE;
+			const int ty = (i / sleep.grid_w) / SLEEP_TILE;
+			for (int y = std::max(0, ty - 1); y <= std::min(sleep.tiles_y - 1, ty + 1); ++y)
+				for (int x = std::max(0, tx - 1); x <= std::min(sleep.tiles_x - 1, tx + 1); ++x)
+					changed = wake_tile_only(y * sleep.tiles_x + x) || changed;
+		}
+		if (changed)
+			build_spans();
+	}
+	// every asleep tile whose particles' box overlaps box
+	void wake_box(const Aabb &box) {
+		if (sleep.asleep_count == 0)
+			return;
+		const auto &P = particles;
+		bool changed = false;
+		for (std::size_t t = 0; t < sleep.asleep.size(); ++t) {
+			if (!sleep.asleep[t])
+				continue;
+			Aabb tile{{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+			for_tile(t, [&](std::size_t i) {
+				tile.lo = {std::min(tile.lo.x, P.px[i]), std::min(tile.lo.y, P.py[i]),
+				           std::min(tile.lo.z, P.pz[i])};
+				tile.hi = {std::max(tile.hi.x, P.px[i]), std::max(tile.hi.y, P.py[i]),
+				           std::max(tile.hi.z, P.pz[i])};
+			});
+			if (tile.overlaps(box))
+				changed = wake_tile_only(t) || changed;
+		}
+		if (changed)
+			build_spans();
+	}
+
+	// what the per particle passes passed over in the last step
+	void count_skipped() {
+		const auto &P = particles;
+		std::uint64_t pinned = 0, frozen = 0;
+		for (std::size_t i = 0; i < P.size(); ++i) {
+			pinned += P.is_pinned(i);
+			frozen += P.is_frozen(i);
+		}
+		profile.set(COUNTER_PINNED, pinned);
+		profile.set(COUNTER_SLEEPING, frozen - pinned);
+	}
+
+	// awake rows of every tile row, neighbouring pieces merged and then cut
+	// into SLEEP_SPAN pieces for the pool
+	void build_spans() {
+		sleep.spans.clear();
+		if (sleep.asleep_count == 0)
+			return;
+		auto push = [&](std::uint32_t b, std::uint32_t e) {
+			if (!sleep.spans.empty() && sleep.spans.back().second == b &&
+			    sleep.spans.back().second - sleep.spans.back().first < SLEEP_SPAN) {
+				b = sleep.spans.back().first;
+				sleep.spans.pop_back();
+			}
+			for (; b < e; b += SLEEP_SPAN)
+				sleep.spans.push_back({b, std::min(e, b + SLEEP_SPAN)});
+		};
+		for (int y = 0; y < sleep.grid_h; ++y) {
+			const int row = (y / SLEEP_TILE) * sleep.tiles_x;
+			const std::uint32_t first = std::uint32_t(y) * sleep.grid_w;
+			for (int tx = 0; tx < sleep.tiles_x;) {
+				if (sleep.asleep[row + tx]) {
+					++tx;
+					continue;
+				}
+				const int start = tx;
+				while (tx < sleep.tiles_x && !sleep.asleep[row + tx])
+					++tx;
+				push(first + start * SLEEP_TILE,
+				     first + std::min(sleep.grid_w, tx * SLEEP_TILE));
+			}
+		}
+	}
+
+	// end of every step. the decisions only read this step's energies and
+	// the old states, so the tile order doesn't matter
+	void update_sleep() {
+		if (!sleep.enabled || !has_tiles())
+			return;
+		auto &P = particles;
+		const std::size_t tiles = sleep.asleep.size();
+		pool.parallel_for(tiles, [&](std::size_t b, std::size_t e) {
+			for (std::size_t t = b; t < e; ++t) {
+				double ke = 0.0;
+				int free = 0;
+				if (!sleep.asleep[t]) {
+					for_tile(t, [&](std::size_t i) {
+						if (P.is_pinned(i))
+							return;
+						const Vec3 v = P.vel(i);
+						ke += 0.5 * P.mass[i] * v.dot(v);
+						++free;
+					});
+				}
+				sleep.tile_energy[t] = free > 0 ? float(ke / free) : 0.0f;
+			}
+		}, 16);
+
+		auto moving = [&](int x, int y) {
+			if (x < 0 || y < 0 || x >= sleep.tiles_x || y >= sleep.tiles_y)
+				return false;
+			const int t = y * sleep.tiles_x + x;
+			return !sleep.asleep[t] && sleep.tile_energy[t] >= sleep.energy;
+		};
+		auto &wake = sleep.wake, &fall = sleep.fall;
+		wake.clear();
+		fall.clear();
+		for (int t = 0; t < int(tiles); ++t) {
+			const int tx = t % sleep.tiles_x, ty = t / sleep.tiles_x;
+			if (sleep.asleep[t]) {
+				bool near = false;
+				for (int dy = -1; dy <= 1; ++dy)
+					for (int dx = -1; dx <= 1; ++dx)
+						near = near || moving(tx + dx, ty + dy);
+				if (near)
+					wake.push_back(t);
+			} else if (sleep.tile_energy[t] < sleep.energy) {
+				if (++sleep.still[t] >= sleep.steps)
+					fall.push_back(t);
+			} else {
+				sleep.still[t] = 0;
+			}
+		}
+		if (wake.empty() && fall.empty())
+			return;
+
+		for (int t : wake)
+			wake_tile_only(t);
+		for (int t : fall) {
+			sleep.asleep[t] = 1;
+			++sleep.asleep_count;
+			for_tile(t, [&](std::size_t i) {
+				P.frozen[i] = 1.0f;
+				P.set_vel(i, {0, 0, 0});
+				P.set_acc(i, {0, 0, 0});
+				P.set_old_pos(i, P.pos(i));
+			});
+		}
+		build_spans();
+	}
+
+	void snapshot_prev() {
+		prev.px = particles.px;
+		prev.py = particles.py;
+		prev.pz = particles.pz;
+	}
+
+	// gather the soa streams into the interleaved render view, flipping y into
+	// render space on the way. positions are prev + (pos - prev) * alpha, a
+	// topology change invalidates prev and that frame shows the current ones
+	void export_view() {
+		const std::size_t n = particles.size();
+		if (view.size() != n * VIEW_STRIDE)
+			view.resize(n * VIEW_STRIDE);
+		export_view_to(view.data());
+	}
+
+	// one substep of solver S. rk never reads acc, get_acceleration sums the
+	// external force and the csr springs itself, so it skips the force pass
+	// and the spring scatter, the contacts still follow. the particle local
+	// solvers add the external force inside the integrator and run the
+	// colliders in the same pass, see integrate_fused. the rest keep their
+	// separate passes
+	using SubstepFn = void (PhysicsWorld::*)(float);
+	template <SolverType S> void substep(float dt) {
+		if constexpr (S == SOLVER_RK2) {
+			integrate_rk2(dt);
+			solve_contacts();
+		} else if constexpr (S == SOLVER_RK4) {
+			integrate_rk4(dt);
+			solve_contacts();
+		} else if constexpr (S == SOLVER_VEOLCITY_VERLET) {
+			integrate_velocity_verlet_pass1(dt);
+			solve_contacts();
+			solve_springs(dt);
+			integrate_velocity_verlet_pass2(dt);
+		} else if constexpr (S == SOLVER_XPBD) {
+			xpbd_predict(dt);
+			std::fill(xpbd_lambda.begin(), xpbd_lambda.end(), 0.0f);
+			for (int it = 0; it < xpbd_iterations; ++it)
+				xpbd_project(dt);
+			solve_contacts();
+			xpbd_finalize(dt);
+		} else if constexpr (S == SOLVER_IMPLICIT_EULER) {
+			// the linear solve takes the whole force from acc
+			apply_forces();
+			solve_springs(dt);
+			integrate_implicit_euler(dt);
+			solve_contacts();
+		} else {
+			solve_springs(dt);
+			integrate_fused<S>(dt);
+		}
+	}
+	// an unknown solver id only ever accumulated forces
+	void substep_unknown(float dt) {
+		apply_forces();
+		solve_springs(dt);
+		solve_contacts();
+	}
+	static auto substep_for(SolverType solver) -> SubstepFn {
+		switch (solver) {
+		case SOLVER_EXPLICIT_EULER:
+			return &PhysicsWorld::substep<SOLVER_EXPLICIT_EULER>;
+		case SOLVER_SYMPLECTIC_EULER:
+			return &PhysicsWorld::substep<SOLVER_SYMPLECTIC_EULER>;
+		case SOLVER_VERLET:
+			return &PhysicsWorld::substep<SOLVER_VERLET>;
+		case SOLVER_TIME_CORRECTED_VERLET:
+			return &PhysicsWorld::substep<SOLVER_TIME_CORRECTED_VERLET>;
+		case SOLVER_RK2:
+			return &PhysicsWorld::substep<SOLVER_RK2>;
+		case SOLVER_RK4:
+			return &PhysicsWorld::substep<SOLVER_RK4>;
+		case SOLVER_IMPLICIT_EULER:
+			return &PhysicsWorld::substep<SOLVER_IMPLICIT_EULER>;
+		case SOLVER_VEOLCITY_VERLET:
+			return &PhysicsWorld::substep<SOLVER_VEOLCITY_VERLET>;
+		case SOLVER_XPBD:
+			return &PhysicsWorld::substep<SOLVER_XPBD>;
+		default:
+			return &PhysicsWorld::substep_unknown;
+		}
+	}
+
+	// external force, integration and the colliders in one walk over the
+	// awake particles, a COLLIDER_BLOCK at a time so the colliders see the
+	// block while it is still in cache. colliders only move the particle they
+	// hit, so block order doesn't matter; self collision does need every
+	// particle moved first and keeps its own pass
+	template <SolverType S> void integrate_fused(float dt) {
+		const Vec3 ext = gravity + wind;
+		const bool contacts = !self_collision && !colliders.empty();
+		for_awake([&](std::size_t b, std::size_t e) {
+			for (std::size_t lo = b; lo < e; lo += COLLIDER_BLOCK) {
+				const std::size_t hi = std::min(e, lo + COLLIDER_BLOCK);
+				if constexpr (S == SOLVER_EXPLICIT_EULER)
+					integrate_explicit_euler(dt, lo, hi, ext);
+				else if constexpr (S == SOLVER_SYMPLECTIC_EULER)
+					integrate_symplectic_euler(dt, lo, hi, ext);
+				else if constexpr (S == SOLVER_VERLET)
+					integrate_verlet(dt, lo, hi, ext);
+				else
+					integrate_tc_verlet(dt, lo, hi, ext);
+				if (contacts)
+					solve_constraints(lo, hi);
+			}
+		});
+		if (!contacts)
+			solve_contacts();
+	}
+
+	void apply_forces() {
+		auto timer = profile.time(PHASE_FORCES);
+		for_awake([&](std::size_t b, std::size_t e) { apply_forces(b, e); });
+	}
+	void apply_forces(std::size_t begin, std::size_t end) {
+		const Vec3 f = gravity + wind;
+		auto &P = particles;
+#ifdef __wasm_simd128__
+		if (use_simd)
+			begin = apply_forces_simd(begin, end);
+#endif
+		for (std::size_t i = begin; i < end; ++i) {
+			if (P.is_frozen(i))
+				continue;
+			P.add_acc(i, f);
+		}
+	}
+
+	// batches run one after another, the springs inside a batch are spread
+	// over the pool since none of them share an endpoint
+	void solve_springs(float dt) {
+		auto timer = profile.time(PHASE_SPRINGS);
+		for (std::size_t b = 0; b < batch_ends.size(); ++b) {
+			const std::size_t first = batch_offsets[b];
+			const std::size_t count = batch_ends[b] - first;
+			// torn springs sit past batch_ends, only the live range is work
+			profile.count(COUNTER_SPRINGS, count);
+			pool.parallel_for(count, [&](std::size_t lo, std::size_t hi) {
+				solve_springs(dt, first + lo, first + hi);
+			});
+		}
+	}
+	// dt is only read by the simd path
+	void solve_springs([[maybe_unused]] float dt, std::size_t begin,
+	                   std::size_t end) {
+		auto &P = particles;
+		float rate = 0.0f;
+#ifdef __wasm_simd128__
+		if (use_simd)
+			begin = solve_springs_simd(dt, begin, end, rate);
+#endif
+		for (std::size_t i = begin; i < end; ++i) {
+			const auto &s = springs[i];
+			// neither end would take the force
+			if (P.is_frozen(s.p1) && P.is_frozen(s.p2))
+				continue;
+			Vec3 delta = P.pos(s.p1) - P.pos(s.p2);
+			float len = delta.length();
+
+			if (len < 0.0001f)
+				continue;
+
+			// hooke
+			float spring_force = (len - s.rest_len) * s.k;
+
+			Vec3 dir = delta * (1.0f / len);
+
+			Vec3 v1 = P.vel(s.p1);
+			Vec3 v2 = P.vel(s.p2);
+			Vec3 rel_vel = v1 - v2;
+
+			float vel_along_spring =
+			    rel_vel.x * dir.x + rel_vel.y * dir.y + rel_vel.z * dir.z;
+
+			float damp_force = vel_along_spring * s.damp;
+			rate = std::max(rate, std::abs(vel_along_spring) / s.rest_len);
+
+			// float max_force = 5000.0f; // arbitrary safety
+			// if (damp_force > max_force)
+			//   damp_force = max_force;
+			// if (damp_force < -max_force)
+			//   damp_force = -max_force;
+
+			float total_f_mag = spring_force + damp_force;
+			scatter_spring(s, dir * total_f_mag);
+		}
+		note_rate(rate);
+	}
+	// p1 is pushed along -f and p2 along +f
+	void scatter_spring(const Spring &s, Vec3 f) {
+		auto &P = particles;
+		if (!P.is_frozen(s.p1))
+			P.add_acc(s.p1, f * -P.inv_mass[s.p1]);
+		if (!P.is_frozen(s.p2))
+			P.add_acc(s.p2, f * P.inv_mass[s.p2]);
+	}
+	// the particle local integrators take the external acceleration (gravity
+	// and wind) as ext and add it to what the springs left in acc, that is
+	// the force pass folded in, see integrate_fused
+	void integrate_verlet(float dt, std::size_t begin, std::size_t end, Vec3 ext) {
+		float dt_sq = dt * dt;
+		auto &P = particles;
+#ifdef __wasm_simd128__
+		if (use_simd)
+			begin = integrate_verlet_simd(dt, begin, end, ext);
+#endif
+		for (std::size_t i = begin; i < end; ++i) {
+			if (P.is_frozen(i))
+				continue;
+
+			Vec3 pos = P.pos(i);
+			Vec3 vel_vec = (pos - P.old_pos(i)) * global_damping;
+
+			Vec3 new_pos = pos + vel_vec + (P.acc(i) + ext) * dt_sq;
+			P.set_pos(i, new_pos);
+			P.set_old_pos(i, pos);
+
+			P.set_vel(i, (new_pos - pos) * (1.0f / dt));
+			P.set_acc(i, {0, 0, 0});
+		}
+	}
+
+	void integrate_tc_verlet(float dt, std::size_t begin, std::size_t end, Vec3 ext) {
+		auto &P = particles;
+#ifdef __wasm_simd128__
+		if (use_simd)
+			begin = integrate_tc_verlet_simd(dt, begin, end, ext);
+#endif
+		for (std::size_t i = begin; i < end; ++i) {
+			if (P.is_frozen(i))
+				continue;
+
+			float dt_prev = P.prev_dt[i];
+
+			if (dt_prev < 1e-5f) {
+				dt_prev = dt;
+			}
+
+			Vec3 pos = P.pos(i);
+			Vec3 expansion = (pos - P.old_pos(i)) * (dt / dt_prev) * global_damping;
+
+			Vec3 new_pos = pos + expansion + (P.acc(i) + ext) * (dt * (dt + dt_prev) * 0.5f);
+
+			P.set_old_pos(i, pos);
+			P.set_pos(i, new_pos);
+
+			P.set_vel(i, (new_pos - pos) * (1.0f / dt));
+
+			P.prev_dt[i] = dt;
+			P.set_acc(i, {0, 0, 0});
+		}
+	}
+	void integrate_velocity_verlet_pass1(float dt) {
+		for_awake([&](std::size_t b, std::size_t e) {
+			integrate_velocity_verlet_pass1(dt, b, e);
+		});
+	}
+	void integrate_velocity_verlet_pass1(float dt, std::size_t begin, std::size_t end) {
+		auto &P = particles;
+#ifdef __wasm_simd128__
+		if (use_simd)
+			begin = integrate_velocity_verlet_pass1_simd(dt, begin, end);
+#endif
+		for (std::size_t i = begin; i < end; ++i) {
+			if (P.is_frozen(i))
+				continue;
+
+			Vec3 vel = P.vel(i) + P.acc(i) * (dt * 0.5f);
+			P.set_vel(i, vel);
+
+			Vec3 pos = P.pos(i) + vel * dt;
+			P.set_pos(i, pos);
+
+			P.set_old_pos(i, pos);
+		}
+	}
+	void integrate_velocity_verlet_pass2(float dt) {
+		const Vec3 ext = gravity + wind;
+		for_awake([&](std::size_t b, std::size_t e) {
+			integrate_velocity_verlet_pass2(dt, b, e, ext);
+		});
+	}
+	void integrate_velocity_verlet_pass2(float dt, std::size_t begin, std::size_t end,
+	                                     Vec3 ext) {
+		auto &P = particles;
+#ifdef __wasm_simd128__
+		if (use_simd)
+			begin = integrate_velocity_verlet_pass2_simd(dt, begin, end, ext);
+#endif
+		for (std::size_t i = begin; i < end; ++i) {
+			if (P.is_frozen(i))
+				continue;
+
+			Vec3 vel = P.vel(i) + (P.acc(i) + ext) * (dt * 0.5f);
+
+			P.set_vel(i, vel * global_damping);
+
+			P.set_acc(i, {0, 0, 0});
+		}
+	}
+
+	// rate, when given, takes the fastest spring stretch rate like solve_springs
+	// reports it, rk never runs that pass
+	Vec3 get_acceleration(int p_idx, Vec3 pos, Vec3 vel,
+	                      float *rate = nullptr) {
+		const auto &P = particles;
+		Vec3 total_force = gravity + wind;
+
+		total_force = total_force - vel * global_damping;
+
+		const std::uint32_t row_end = adj_offsets[p_idx + 1];
+
+		for (std::uint32_t e = adj_offsets[p_idx]; e < row_end; ++e) {
+			const Edge &s = adj_data[e];
+			const std::uint32_t other_idx = adj_indices[e];
+
+			Vec3 other_pos = {rk_src.px[other_idx], rk_src.py[other_idx],
+			                  rk_src.pz[other_idx]};
+			Vec3 delta = pos - other_pos;
+
+			float dist = delta.length();
+			if (dist < 0.0001f)
+				continue;
+
+			Vec3 dir = delta * (1.0f / dist);
+			float displacement = dist - s.rest_len;
+
+			// hooke 2
+			float spring_force = displacement * s.k;
+
+			Vec3 other_vel = {rk_src.vx[other_idx], rk_src.vy[other_idx],
+			                  rk_src.vz[other_idx]};
+			Vec3 rel_vel = vel - other_vel;
+			float vel_along_spring =
+			    rel_vel.x * dir.x + rel_vel.y * dir.y + rel_vel.z * dir.z;
+			float damp_force = vel_along_spring * s.damp;
+			if (rate)
+				*rate = std::max(*rate, std::abs(vel_along_spring) / s.rest_len);
+
+			Vec3 force = dir * -(spring_force + damp_force);
+			total_force = total_force + force;
+		}
+
+		return total_force * P.inv_mass[p_idx];
+	}
+
+	void snapshot_rk_src() {
+		const auto &P = particles;
+		rk_src.px.assign(P.px.begin(), P.px.end());
+		rk_src.py.assign(P.py.begin(), P.py.end());
+		rk_src.pz.assign(P.pz.begin(), P.pz.end());
+		rk_src.vx.assign(P.vx.begin(), P.vx.end());
+		rk_src.vy.assign(P.vy.begin(), P.vy.end());
+		rk_src.vz.assign(P.vz.begin(), P.vz.end());
+	}
+
+	void integrate_rk2(float dt) {
+		snapshot_rk_src();
+		for_awake([&](std::size_t b, std::size_t e) {
+			integrate_rk2(dt, b, e);
+		});
+	}
+	void integrate_rk2(float dt, std::size_t begin, std::size_t end) {
+		auto &P = particles;
+		float rate = 0.0f;
+		for (std::size_t i = begin; i < end; ++i) {
+			if (P.is_frozen(i))
+				continue;
+
+			Vec3 x0 = P.pos(i);
+			Vec3 v0 = P.vel(i);
+
+			Vec3 a1 = get_acceleration(i, x0, v0, &rate);
+
+			Vec3 x_mid = x0 + v0 * (dt * 0.5f);
+			Vec3 v_mid = v0 + a1 * (dt * 0.5f);
+
+			Vec3 a2 = get_acceleration(i, x_mid, v_mid);
+
+			Vec3 pos = x0 + v_mid * dt;
+			Vec3 vel = v0 + a2 * dt;
+			P.set_pos(i, pos);
+			P.set_vel(i, vel);
+
+			// verlet compatibility
+			P.set_old_pos(i, pos - vel * dt);
+			P.set_acc(i, {0, 0, 0});
+		}
+		note_rate(rate);
+	}
+	void integrate_rk4(float dt) {
+		snapshot_rk_src();
+		for_awake([&](std::size_t b, std::size_t e) {
+			integrate_rk4(dt, b, e);
+		});
+	}
+	void integrate_rk4(float dt, std::size_t begin, std::size_t end) {
+		auto &P = particles;
+		float rate = 0.0f;
+		for (std::size_t i = begin; i < end; ++i) {
+			if (P.is_frozen(i))
+				continue;
+
+			Vec3 x = P.pos(i);
+			Vec3 v = P.vel(i);
+
+			Vec3 a1 = get_acceleration(i, x, v, &rate);
+			Vec3 v1 = v;
+
+			Vec3 x2 = x + v1 * (dt * 0.5f);
+			Vec3 v2 = v + a1 * (dt * 0.5f);
+			Vec3 a2 = get_acceleration(i, x2, v2);
+
+			Vec3 x3 = x + v2 * (dt * 0.5f);
+			Vec3 v3 = v + a2 * (dt * 0.5f);
+			Vec3 a3 = get_acceleration(i, x3, v3);
+
+			Vec3 x4 = x + v3 * dt;
+			Vec3 v4 = v + a3 * dt;
+			Vec3 a4 = get_acceleration(i, x4, v4);
+
+			Vec3 pos = x + (v1 + v2 * 2.0f + v3 * 2.0f + v4) * (dt / 6.0f);
+
+			Vec3 vel = v + (a1 + a2 * 2.0f + a3 * 2.0f + a4) * (dt / 6.0f);
+			P.set_pos(i, pos);
+			P.set_vel(i, vel);
+
+			P.set_old_pos(i, pos - vel * dt);
+			P.set_acc(i, {0, 0, 0});
+		}
+		note_rate(rate);
+	}
+	// linearized backward euler (baraff & witkin 98). solves
+	//   (M + h D + h^2 K) dv = h f0 - h^2 K v0
+	// with a jacobi preconditioned cg where every product walks the csr rows,
+	// so nothing is assembled. K drops the compressive part of the spring
+	// hessian to stay positive definite. pinned particles are filtered out of
+	// the system, which keeps their dv at zero
+	void integrate_implicit_euler(float dt) {
+		auto &P = particles;
+		const std::size_t n = P.size();
+		const float h = dt;
+		const float h_sq = dt * dt;
+
+		cg.blocks.resize(adj_indices.size());
+		for (auto *v : {&cg.rhs, &cg.x, &cg.r, &cg.z, &cg.p, &cg.q, &cg.inv_diag})
+			v->resize(n);
+
+		auto for_rows = [&](auto &&row) {
+			pool.parallel_for(n, [&](std::size_t b, std::size_t e) {
+				for (std::size_t i = b; i < e; ++i)
+					row(i);
+			});
+		};
+		// sum over (A v)_i for the filtered system, A v = M v + sum a dv + b d(d.dv)
+		auto apply_a = [&](const std::vector<Vec3> &in, std::vector<Vec3> &out) {
+			for_rows([&](std::size_t i) {
+				if (P.is_frozen(i)) {
+					out[i] = {0, 0, 0};
+					return;
+				}
+				Vec3 acc = in[i] * P.mass[i];
+				for (std::uint32_t e = adj_offsets[i]; e < adj_offsets[i + 1]; ++e) {
+					const EdgeBlock &blk = cg.blocks[e];
+					Vec3 dv = in[i] - in[adj_indices[e]];
+					acc = acc + dv * blk.a + blk.dir * (blk.b * blk.dir.dot(dv));
+				}
+				out[i] = acc;
+			});
+		};
+
+		// linearize every spring around the current state and build the rhs and
+		// the preconditioner in the same pass
+		for_rows([&](std::size_t i) {
+			const Vec3 xi = P.pos(i);
+			const Vec3 vi = P.vel(i);
+			Vec3 diag{P.mass[i], P.mass[i], P.mass[i]};
+			Vec3 kv{0, 0, 0};
+			for (std::uint32_t e = adj_offsets[i]; e < adj_offsets[i + 1]; ++e) {
+				const std::uint32_t j = adj_indices[e];
+				const Edge &s = adj_data[e];
+				Vec3 delta = xi - P.pos(j);
+				float len = delta.length();
+				EdgeBlock blk{{0, 0, 0}, 0, 0, 0, 0};
+				if (len >= 0.0001f) {
+					blk.dir = delta * (1.0f / len);
+					float c = std::max(0.0f, 1.0f - s.rest_len / len);
+					blk.ka = h_sq * s.k * c;
+					blk.kb = h_sq * s.k * (1.0f - c);
+					blk.a = blk.ka;
+					blk.b = blk.kb + h * s.damp;
+				}
+				cg.blocks[e] = blk;
+
+				Vec3 dv = vi - P.vel(j);
+				kv = kv + dv * blk.ka + blk.dir * (blk.kb * blk.dir.dot(dv));
+				diag = diag + Vec3{blk.a + blk.b * blk.dir.x * blk.dir.x,
+				                   blk.a + blk.b * blk.dir.y * blk.dir.y,
+				                   blk.a + blk.b * blk.dir.z * blk.dir.z};
+			}
+			cg.inv_diag[i] = {1.0f / diag.x, 1.0f / diag.y, 1.0f / diag.z};
+			// acc holds f0 / m from apply_forces and solve_springs
+			cg.rhs[i] = P.is_frozen(i) ? Vec3{0, 0, 0}
+			                           : P.acc(i) * (h * P.mass[i]) - kv;
+		});
+
+		auto precondition = [&](std::size_t i) {
+			cg.z[i] = {cg.r[i].x * cg.inv_diag[i].x, cg.r[i].y * cg.inv_diag[i].y,
+			           cg.r[i].z * cg.inv_diag[i].z};
+		};
+		for_rows([&](std::size_t i) {
+			cg.x[i] = {0, 0, 0};
+			cg.r[i] = cg.rhs[i];
+			precondition(i);
+			cg.p[i] = cg.z[i];
+		});
+
+		const double rhs_sq = reduce_sum([&](std::size_t i) {
+			return cg.rhs[i].dot(cg.rhs[i]);
+		});
+		const double stop_sq = rhs_sq * cg.tolerance * cg.tolerance;
+		double rz = reduce_sum([&](std::size_t i) { return cg.r[i].dot(cg.z[i]); });
+
+		cg.last_iters = 0;
+		for (int it = 0; it < cg.max_iters && rhs_sq > 0.0; ++it) {
+			apply_a(cg.p, cg.q);
+			const double pq =
+			    reduce_sum([&](std::size_t i) { return cg.p[i].dot(cg.q[i]); });
+			if (pq <= 0.0)
+				break;
+			const float alpha = static_cast<float>(rz / pq);
+
+			const double r_sq = reduce_sum([&](std::size_t i) {
+				cg.x[i] = cg.x[i] + cg.p[i] * alpha;
+				cg.r[i] = cg.r[i] - cg.q[i] * alpha;
+				precondition(i);
+				return cg.r[i].dot(cg.r[i]);
+			});
+			cg.last_iters = it + 1;
+			if (r_sq <= stop_sq)
+				break;
+
+			const double rz_new =
+			    reduce_sum([&](std::size_t i) { return cg.r[i].dot(cg.z[i]); });
+			const float beta = static_cast<float>(rz_new / rz);
+			rz = rz_new;
+			for_rows([&](std::size_t i) { cg.p[i] = cg.z[i] + cg.p[i] * beta; });
+		}
+
+		for_rows([&](std::size_t i) {
+			if (P.is_frozen(i))
+				return;
+			Vec3 vel = (P.vel(i) + cg.x[i]) * global_damping;
+			Vec3 pos = P.pos(i) + vel * dt;
+			P.set_vel(i, vel);
+			P.set_pos(i, pos);
+
+			// verlet compatibility
+			P.set_old_pos(i, pos - vel * dt);
+			P.set_acc(i, {0, 0, 0});
+		});
+	}
+
+	// sum of term(i) over all particles. partial sums are per chunk and added
+	// in chunk order, so the result doesn't depend on which thread ran what
+	template <class F> double reduce_sum(F &&term) {
+		if (deterministic) {
+			// same REDUCE_CHUNKS partials summed in the same order, whichever
+			// thread got them
+			const std::size_t n = particles.size();
+			cg.partials.assign(REDUCE_CHUNKS, 0.0);
+			pool.parallel_for(REDUCE_CHUNKS, [&](std::size_t c0, std::size_t c1) {
+				for (std::size_t c = c0; c < c1; ++c) {
+					double acc = 0.0;
+					for (std::size_t i = n * c / REDUCE_CHUNKS; i < n * (c + 1) / REDUCE_CHUNKS; ++i)
+						acc += term(i);
+					cg.partials[c] = acc;
+				}
+			}, 1);
+			double total = 0.0;
+			for (double v : cg.partials)
+				total += v;
+			return total;
+		}
+		const int chunks = pool.size();
+		cg.partials.assign(chunks, 0.0);
+		pool.parallel_chunks(particles.size(), chunks,
+		                     [&](int c, std::size_t b, std::size_t e) {
+			double acc = 0.0;
+			for (std::size_t i = b; i < e; ++i)
+				acc += term(i);
+			cg.partials[c] = acc;
+		});
+		double total = 0.0;
+		for (double v : cg.partials)
+			total += v;
+		return total;
+	}
+
+	void integrate_explicit_euler(float dt, std::size_t begin, std::size_t end,
+	                              Vec3 ext) {
+		auto &P = particles;
+#ifdef __wasm_simd128__
+		if (use_simd)
+			begin = integrate_explicit_euler_simd(dt, begin, end, ext);
+#endif
+		for (std::size_t i = begin; i < end; ++i) {
+			if (P.is_frozen(i))
+				continue;
+
+			Vec3 pos = P.pos(i) + P.vel(i) * dt;
+			Vec3 vel = (P.vel(i) + (P.acc(i) + ext) * dt) * global_damping;
+			P.set_pos(i, pos);
+			P.set_vel(i, vel);
+
+			P.set_old_pos(i, pos);
+			P.set_acc(i, {0, 0, 0});
+		}
+	}
+
+	void integrate_symplectic_euler(float dt, std::size_t begin, std::size_t end,
+	                                Vec3 ext) {
+		auto &P = particles;
+#ifdef __wasm_simd128__
+		if (use_simd)
+			begin = integrate_symplectic_euler_simd(dt, begin, end, ext);
+#endif
+		for (std::size_t i = begin; i < end; ++i) {
+			if (P.is_frozen(i))
+				continue;
+
+			Vec3 vel = (P.vel(i) + (P.acc(i) + ext) * dt) * global_damping;
+			Vec3 pos = P.pos(i) + vel * dt;
+			P.set_vel(i, vel);
+			P.set_pos(i, pos);
+
+			P.set_old_pos(i, pos);
+			P.set_acc(i, {0, 0, 0});
+		}
+	}
+
+	// xpbd (macklin et al. 16). springs become distance constraints with
+	// compliance 1 / k, spring damping maps onto the constraint damping term.
+	// predict moves everything by its velocity, project runs over the colour
+	// batches like solve_springs, finalize derives the velocity from the
+	// displacement. old_pos holds the substep start for the damping term
+	void xpbd_predict(float dt) {
+		const Vec3 ext = gravity + wind;
+		for_awake([&](std::size_t b, std::size_t e) {
+			auto &P = particles;
+			for (std::size_t i = b; i < e; ++i) {
+				if (P.is_frozen(i))
+					continue;
+				Vec3 pos = P.pos(i);
+				Vec3 vel = P.vel(i) + (P.acc(i) + ext) * dt;
+				P.set_old_pos(i, pos);
+				P.set_pos(i, pos + vel * dt);
+				P.set_acc(i, {0, 0, 0});
+			}
+		});
+	}
+
+	void xpbd_project(float dt) {
+		auto timer = profile.time(PHASE_SPRINGS);
+		xpbd_lambda.resize(springs.size(), 0.0f);
+		for (std::size_t b = 0; b < batch_ends.size(); ++b) {
+			const std::size_t first = batch_offsets[b];
+			const std::size_t count = batch_ends[b] - first;
+			profile.count(COUNTER_SPRINGS, count);
+			pool.parallel_for(count, [&](std::size_t lo, std::size_t hi) {
+				xpbd_project(dt, first + lo, first + hi);
+			});
+		}
+	}
+	void xpbd_project(float dt, std::size_t begin, std::size_t end) {
+		auto &P = particles;
+		const float dt_sq = dt * dt;
+		float rate = 0.0f;
+		for (std::size_t i = begin; i < end; ++i) {
+			const auto &s = springs[i];
+			const float w1 = P.is_frozen(s.p1) ? 0.0f : P.inv_mass[s.p1];
+			const float w2 = P.is_frozen(s.p2) ? 0.0f : P.inv_mass[s.p2];
+			if (w1 + w2 <= 0.0f || s.k <= 0.0f)
+				continue;
+
+			Vec3 delta = P.pos(s.p1) - P.pos(s.p2);
+			float len = delta.length();
+			if (len < 0.0001f)
+				continue;
+			Vec3 n = delta * (1.0f / len);
+
+			// alpha~ = alpha / h^2, gamma = alpha~ beta~ / h with beta~ = h^2 damp
+			float alpha = 1.0f / (s.k * dt_sq);
+			float gamma = s.damp / (s.k * dt);
+
+			Vec3 moved = (P.pos(s.p1) - P.old_pos(s.p1)) -
+			             (P.pos(s.p2) - P.old_pos(s.p2));
+			float c = len - s.rest_len;
+			rate = std::max(rate, std::abs(n.dot(moved)) / (dt * s.rest_len));
+			float &lambda = xpbd_lambda[i];
+			float d_lambda = (-c - alpha * lambda - gamma * n.dot(moved)) /
+			                 ((1.0f + gamma) * (w1 + w2) + alpha);
+			lambda += d_lambda;
+
+			Vec3 corr = n * d_lambda;
+			P.set_pos(s.p1, P.pos(s.p1) + corr * w1);
+			P.set_pos(s.p2, P.pos(s.p2) - corr * w2);
+		}
+		note_rate(rate);
+	}
+
+	void xpbd_finalize(float dt) {
+		for_awake([&](std::size_t b, std::size_t e) {
+			auto &P = particles;
+			const float inv_dt = 1.0f / dt;
+			for (std::size_t i = b; i < e; ++i) {
+				if (P.is_frozen(i))
+					continue;
+				P.set_vel(i, (P.pos(i) - P.old_pos(i)) * (inv_dt * global_damping));
+			}
+		});
+	}
+
+	void integrate(float dt) { // old & useless
+		float dt_sq = dt * dt;
+		auto &P = particles;
+		for (std::size_t i = 0; i < P.size(); ++i) {
+			if (P.is_frozen(i))
+				continue;
+
+			// verlet
+			// x(t+1) = x(t) + (x(t) - x(t-1)) + a(t) * dt^2
+
+			Vec3 pos = P.pos(i);
+			Vec3 vel = (pos - P.old_pos(i)) * global_damping;
+			P.set_old_pos(i, pos);
+			P.set_pos(i, pos + vel + P.acc(i) * dt_sq);
+
+			P.set_acc(i, {0, 0, 0});
+		}
+	}
+
+	// everything positional that runs after the integrator
+	void solve_contacts() {
+		auto timer = profile.time(PHASE_CONTACTS);
+		if (self_collision)
+			solve_self_collisions();
+		solve_constraints();
+	}
+
+	// jacobi: every particle sums its pushes against the positions from
+	// before the pass, then they are all applied. independent of thread count
+	// and of the order inside a bucket. asleep particles stay in the hash as
+	// obstacles but neither pass visits them
+	void solve_self_collisions() {
+		auto &P = particles;
+		const std::size_t n = P.size();
+		const float min_dist = 2.0f * collision_radius;
+		if (n == 0 || min_dist <= 0.0f)
+			return;
+
+		// cells twice the contact distance, so a query only looks at 8 of them
+		hash.build(P.px.data(), P.py.data(), P.pz.data(), n, 2.0f * min_dist, pool);
+
+		contact.dx.resize(n);
+		contact.dy.resize(n);
+		contact.dz.resize(n);
+		const float min_sq = min_dist * min_dist;
+		for_awake([&](std::size_t b, std::size_t e) {
+			for (std::size_t i = b; i < e; ++i) {
+				Vec3 push{0, 0, 0};
+				if (!P.is_frozen(i)) {
+					const Vec3 xi = P.pos(i);
+					hash.for_each_near(xi.x, xi.y, xi.z, min_dist, [&](std::uint32_t j) {
+						if (j == i)
+							return;
+						Vec3 delta = xi - P.pos(j);
+						float d_sq = delta.dot(delta);
+						if (d_sq >= min_sq || d_sq < 1e-12f || connected(i, j))
+							return;
+						float d = std::sqrt(d_sq);
+						// a pinned partner doesn't move, so this side takes it all
+						float share = P.is_frozen(j) ? 1.0f : 0.5f;
+						push = push + delta * ((min_dist - d) * share / d);
+					});
+				}
+				contact.dx[i] = push.x;
+				contact.dy[i] = push.y;
+				contact.dz[i] = push.z;
+			}
+		});
+		for_awake([&](std::size_t b, std::size_t e) {
+			for (std::size_t i = b; i < e; ++i) {
+				const Vec3 push{contact.dx[i], contact.dy[i], contact.dz[i]};
+				const float len_sq = push.dot(push);
+				if (len_sq == 0.0f)
+					continue;
+				P.set_pos(i, P.pos(i) + push);
+				// the verlet style solvers get their separating velocity from the
+				// position change, the velocity ones lose the approaching part
+				const Vec3 n = push * (1.0f / std::sqrt(len_sq));
+				const Vec3 v = P.vel(i);
+				const float vn = v.dot(n);
+				if (vn < 0.0f)
+					P.set_vel(i, v - n * vn);
+			}
+		});
+	}
+
+	bool connected(std::size_t i, std::uint32_t j) const {
+		for (std::uint32_t e = adj_offsets[i]; e < adj_offsets[i + 1]; ++e)
+			if (adj_indices[e] == j)
+				return true;
+		return false;
+	}
+
+	auto add_collider(const Collider &c) -> int {
+		wake_box(c.bounds());
+		colliders.push_back(c);
+		collider_view.resize(colliders.size() * COLLIDER_STRIDE);
+		c.pack(&collider_view[(colliders.size() - 1) * COLLIDER_STRIDE]);
+		return colliders.size() - 1;
+	}
+
+	// one pass over all colliders. every block of particles takes its box
+	// first and only runs the colliders that can reach it
+	void solve_constraints() {
+		if (colliders.empty())
+			return;
+		const std::size_t n = particles.size();
+		const std::size_t blocks = (n + COLLIDER_BLOCK - 1) / COLLIDER_BLOCK;
+		pool.parallel_for(blocks, [&](std::size_t b, std::size_t e) {
+			for (std::size_t blk = b; blk < e; ++blk)
+				solve_constraints(blk * COLLIDER_BLOCK, std::min(n, (blk + 1) * COLLIDER_BLOCK));
+		});
+	}
+	void solve_constraints(std::size_t begin, std::size_t end) {
+		auto &P = particles;
+		Aabb box{P.pos(begin), P.pos(begin)};
+		for (std::size_t i = begin + 1; i < end; ++i) {
+			box.lo = {std::min(box.lo.x, P.px[i]), std::min(box.lo.y, P.py[i]),
+			          std::min(box.lo.z, P.pz[i])};
+			box.hi = {std::max(box.hi.x, P.px[i]), std::max(box.hi.y, P.py[i]),
+			          std::max(box.hi.z, P.pz[i])};
+		}
+
+		for (const Collider &c : colliders) {
+			if (c.type == COLLIDER_PLANE ? c.plane_clear(box) : !c.bounds().overlaps(box))
+				continue;
+			for (std::size_t i = begin; i < end; ++i) {
+				Contact hit;
+				if (P.is_frozen(i) || !c.collide(P.pos(i), sdf_pool.data(), hit))
+					continue;
+				resolve_contact(i, c, hit);
+			}
+		}
+	}
+
+	// out of the surface, then the approaching part of the motion goes. the
+	// verlet solvers and xpbd carry it in the old position, the rest in vel
+	void resolve_contact(std::size_t i, const Collider &c, const Contact &hit) {
+		auto &P = particles;
+		auto respond = [&](Vec3 v) {
+			const float vn = v.dot(hit.normal);
+			if (vn >= 0.0f)
+				return v;
+			const Vec3 vt = v - hit.normal * vn;
+			return vt * (1.0f - c.friction) - hit.normal * (vn * c.restitution);
+		};
+		const Vec3 pos = P.pos(i) + hit.normal * hit.depth;
+		P.set_pos(i, pos);
+		P.set_old_pos(i, pos - respond(pos - P.old_pos(i)));
+		P.set_vel(i, respond(P.vel(i)));
+	}
+
+#ifdef __wasm_simd128__
+	// simd128 versions of the particle passes, 4 particles per iteration. they
+	// stop at the last full group of 4 and return where the scalar loop has to
+	// pick up. frozen lanes are masked with bitselect instead of branching
+
+	static v128_t ld(const float *p) {
+		return wasm_v128_load(p);
+	}
+	static void st(float *p, v128_t v) {
+		wasm_v128_store(p, v);
+	}
+	static v128_t free_mask(const float *pinned) {
+		return wasm_f32x4_lt(ld(pinned), wasm_f32x4_splat(0.5f));
+	}
+
+	std::size_t apply_forces_simd(std::size_t begin, std::size_t end) {
+		auto &P = particles;
+		const Vec3 f = gravity + wind;
+		const v128_t fx = wasm_f32x4_splat(f.x);
+		const v128_t fy = wasm_f32x4_splat(f.y);
+		const v128_t fz = wasm_f32x4_splat(f.z);
+		const v128_t zero = wasm_f32x4_splat(0.0f);
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4) {
+			v128_t m = free_mask(&P.frozen[i]);
+			auto axis = [&](float *a, v128_t f) {
+				st(a, wasm_f32x4_add(ld(a), wasm_v128_bitselect(f, zero, m)));
+			};
+			axis(&P.ax[i], fx);
+			axis(&P.ay[i], fy);
+			axis(&P.az[i], fz);
+		}
+		return i;
+	}
+
+	// evaluates 4 springs at once. lanes come from the same batch so they never
+	// share a particle, the scatter is scalar only because wasm has no scatter.
+	// rate gets the fastest relative spring speed like the scalar loop
+	std::size_t solve_springs_simd(float dt, std::size_t begin, std::size_t end,
+	                               float &rate) {
+		auto &P = particles;
+		const v128_t eps = wasm_f32x4_splat(0.0001f);
+		const v128_t one = wasm_f32x4_splat(1.0f);
+		v128_t rates = wasm_f32x4_splat(0.0f);
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4) {
+			const Spring *s = &springs[i];
+			const int a0 = s[0].p1, a1 = s[1].p1, a2 = s[2].p1, a3 = s[3].p1;
+			const int b0 = s[0].p2, b1 = s[1].p2, b2 = s[2].p2, b3 = s[3].p2;
+
+			auto ga = [&](const AlignedVec<float> &v) {
+				return wasm_f32x4_make(v[a0], v[a1], v[a2], v[a3]);
+			};
+			auto gb = [&](const AlignedVec<float> &v) {
+				return wasm_f32x4_make(v[b0], v[b1], v[b2], v[b3]);
+			};
+
+			v128_t dx = wasm_f32x4_sub(ga(P.px), gb(P.px));
+			v128_t dy = wasm_f32x4_sub(ga(P.py), gb(P.py));
+			v128_t dz = wasm_f32x4_sub(ga(P.pz), gb(P.pz));
+
+			v128_t len = wasm_f32x4_sqrt(wasm_f32x4_add(
+			    wasm_f32x4_add(wasm_f32x4_mul(dx, dx), wasm_f32x4_mul(dy, dy)),
+			    wasm_f32x4_mul(dz, dz)));
+			v128_t valid = wasm_f32x4_ge(len, eps);
+			v128_t inv_len =
+			    wasm_f32x4_div(one, wasm_v128_bitselect(len, one, valid));
+
+			dx = wasm_f32x4_mul(dx, inv_len);
+			dy = wasm_f32x4_mul(dy, inv_len);
+			dz = wasm_f32x4_mul(dz, inv_len);
+
+			v128_t rvx = wasm_f32x4_sub(ga(P.vx), gb(P.vx));
+			v128_t rvy = wasm_f32x4_sub(ga(P.vy), gb(P.vy));
+			v128_t rvz = wasm_f32x4_sub(ga(P.vz), gb(P.vz));
+			v128_t along = wasm_f32x4_add(
+			    wasm_f32x4_add(wasm_f32x4_mul(rvx, dx), wasm_f32x4_mul(rvy, dy)),
+			    wasm_f32x4_mul(rvz, dz));
+
+			v128_t rest = wasm_f32x4_make(s[0].rest_len, s[1].rest_len,
+			                              s[2].rest_len, s[3].rest_len);
+			v128_t k = wasm_f32x4_make(s[0].k, s[1].k, s[2].k, s[3].k);
+			v128_t damp =
+			    wasm_f32x4_make(s[0].damp, s[1].damp, s[2].damp, s[3].damp);
+
+			v128_t mag =
+			    wasm_f32x4_add(wasm_f32x4_mul(wasm_f32x4_sub(len, rest), k),
+			                   wasm_f32x4_mul(along, damp));
+			mag = wasm_v128_and(mag, valid);
+			rates = wasm_f32x4_max(
+			    rates, wasm_v128_and(wasm_f32x4_div(wasm_f32x4_abs(along), rest), valid));
+
+			alignas(16) float fx[4], fy[4], fz[4];
+			st(fx, wasm_f32x4_mul(dx, mag));
+			st(fy, wasm_f32x4_mul(dy, mag));
+			st(fz, wasm_f32x4_mul(dz, mag));
+			for (int l = 0; l < 4; ++l)
+				scatter_spring(s[l], {fx[l], fy[l], fz[l]});
+		}
+		rate = std::max({rate, wasm_f32x4_extract_lane(rates, 0), wasm_f32x4_extract_lane(rates, 1),
+		                 wasm_f32x4_extract_lane(rates, 2), wasm_f32x4_extract_lane(rates, 3)});
+		return i;
+	}
+
+	// the external acceleration per axis, for the integrators' ext
+	struct Ext4 {
+		v128_t x, y, z;
+		explicit Ext4(Vec3 e)
+		    : x(wasm_f32x4_splat(e.x)), y(wasm_f32x4_splat(e.y)),
+		      z(wasm_f32x4_splat(e.z)) {}
+	};
+
+	std::size_t integrate_verlet_simd(float dt, std::size_t begin,
+	                                  std::size_t end, Vec3 ext) {
+		auto &P = particles;
+		const v128_t dt_sq = wasm_f32x4_splat(dt * dt);
+		const v128_t damp = wasm_f32x4_splat(global_damping);
+		const v128_t inv_dt = wasm_f32x4_splat(1.0f / dt);
+		const v128_t zero = wasm_f32x4_splat(0.0f);
+		const Ext4 e(ext);
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4) {
+			v128_t m = free_mask(&P.frozen[i]);
+			auto axis = [&](float *p, float *o, float *v, float *a, v128_t e) {
+				v128_t x = ld(p), xo = ld(o), a_in = ld(a);
+				v128_t nx = wasm_f32x4_add(
+				    wasm_f32x4_add(x, wasm_f32x4_mul(wasm_f32x4_sub(x, xo), damp)),
+				    wasm_f32x4_mul(wasm_f32x4_add(a_in, e), dt_sq));
+				st(p, wasm_v128_bitselect(nx, x, m));
+				st(o, wasm_v128_bitselect(x, xo, m));
+				v128_t nv = wasm_f32x4_mul(wasm_f32x4_sub(nx, x), inv_dt);
+				st(v, wasm_v128_bitselect(nv, ld(v), m));
+				st(a, wasm_v128_bitselect(zero, a_in, m));
+			};
+			axis(&P.px[i], &P.ox[i], &P.vx[i], &P.ax[i], e.x);
+			axis(&P.py[i], &P.oy[i], &P.vy[i], &P.ay[i], e.y);
+			axis(&P.pz[i], &P.oz[i], &P.vz[i], &P.az[i], e.z);
+		}
+		return i;
+	}
+
+	std::size_t integrate_tc_verlet_simd(float dt, std::size_t begin,
+	                                     std::size_t end, Vec3 ext) {
+		auto &P = particles;
+		const v128_t vdt = wasm_f32x4_splat(dt);
+		const v128_t damp = wasm_f32x4_splat(global_damping);
+		const v128_t inv_dt = wasm_f32x4_splat(1.0f / dt);
+		const v128_t half = wasm_f32x4_splat(0.5f);
+		const v128_t tiny = wasm_f32x4_splat(1e-5f);
+		const v128_t zero = wasm_f32x4_splat(0.0f);
+		const Ext4 e(ext);
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4) {
+			v128_t m = free_mask(&P.frozen[i]);
+			v128_t dt_prev = ld(&P.prev_dt[i]);
+			dt_prev = wasm_v128_bitselect(vdt, dt_prev, wasm_f32x4_lt(dt_prev, tiny));
+
+			v128_t ratio = wasm_f32x4_mul(wasm_f32x4_div(vdt, dt_prev), damp);
+			v128_t acc_scale = wasm_f32x4_mul(
+			    wasm_f32x4_mul(vdt, wasm_f32x4_add(vdt, dt_prev)), half);
+
+			auto axis = [&](float *p, float *o, float *v, float *a, v128_t e) {
+				v128_t x = ld(p), xo = ld(o), a_in = ld(a);
+				v128_t nx = wasm_f32x4_add(
+				    wasm_f32x4_add(x, wasm_f32x4_mul(wasm_f32x4_sub(x, xo), ratio)),
+				    wasm_f32x4_mul(wasm_f32x4_add(a_in, e), acc_scale));
+				st(p, wasm_v128_bitselect(nx, x, m));
+				st(o, wasm_v128_bitselect(x, xo, m));
+				v128_t nv = wasm_f32x4_mul(wasm_f32x4_sub(nx, x), inv_dt);
+				st(v, wasm_v128_bitselect(nv, ld(v), m));
+				st(a, wasm_v128_bitselect(zero, a_in, m));
+			};
+			axis(&P.px[i], &P.ox[i], &P.vx[i], &P.ax[i], e.x);
+			axis(&P.py[i], &P.oy[i], &P.vy[i], &P.ay[i], e.y);
+			axis(&P.pz[i], &P.oz[i], &P.vz[i], &P.az[i], e.z);
+			st(&P.prev_dt[i], wasm_v128_bitselect(vdt, ld(&P.prev_dt[i]), m));
+		}
+		return i;
+	}
+
+	std::size_t integrate_velocity_verlet_pass1_simd(float dt, std::size_t begin,
+	                                                 std::size_t end) {
+		auto &P = particles;
+		const v128_t vdt = wasm_f32x4_splat(dt);
+		const v128_t half_dt = wasm_f32x4_splat(dt * 0.5f);
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4) {
+			v128_t m = free_mask(&P.frozen[i]);
+			auto axis = [&](float *p, float *o, float *v, const float *a) {
+				v128_t x = ld(p), vel = ld(v);
+				v128_t nv = wasm_f32x4_add(vel, wasm_f32x4_mul(ld(a), half_dt));
+				v128_t nx = wasm_f32x4_add(x, wasm_f32x4_mul(nv, vdt));
+				st(v, wasm_v128_bitselect(nv, vel, m));
+				st(p, wasm_v128_bitselect(nx, x, m));
+				st(o, wasm_v128_bitselect(nx, ld(o), m));
+			};
+			axis(&P.px[i], &P.ox[i], &P.vx[i], &P.ax[i]);
+			axis(&P.py[i], &P.oy[i], &P.vy[i], &P.ay[i]);
+			axis(&P.pz[i], &P.oz[i], &P.vz[i], &P.az[i]);
+		}
+		return i;
+	}
+
+	std::size_t integrate_velocity_verlet_pass2_simd(float dt, std::size_t begin,
+	                                                 std::size_t end, Vec3 ext) {
+		auto &P = particles;
+		const v128_t half_dt = wasm_f32x4_splat(dt * 0.5f);
+		const v128_t damp = wasm_f32x4_splat(global_damping);
+		const v128_t zero = wasm_f32x4_splat(0.0f);
+		const Ext4 e(ext);
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4) {
+			v128_t m = free_mask(&P.frozen[i]);
+			auto axis = [&](float *v, float *a, v128_t e) {
+				v128_t vel = ld(v), a_in = ld(a);
+				v128_t nv = wasm_f32x4_mul(
+				    wasm_f32x4_add(vel, wasm_f32x4_mul(wasm_f32x4_add(a_in, e), half_dt)),
+				    damp);
+				st(v, wasm_v128_bitselect(nv, vel, m));
+				st(a, wasm_v128_bitselect(zero, a_in, m));
+			};
+			axis(&P.vx[i], &P.ax[i], e.x);
+			axis(&P.vy[i], &P.ay[i], e.y);
+			axis(&P.vz[i], &P.az[i], e.z);
+		}
+		return i;
+	}
+
+	// explicit: x += v dt then v += a dt, symplectic: v += a dt then x += v dt
+	template <bool Symplectic>
+	std::size_t integrate_euler_simd(float dt, std::size_t begin, std::size_t end,
+	                                 Vec3 ext) {
+		auto &P = particles;
+		const v128_t vdt = wasm_f32x4_splat(dt);
+		const v128_t damp = wasm_f32x4_splat(global_damping);
+		const v128_t zero = wasm_f32x4_splat(0.0f);
+		const Ext4 e(ext);
+		std::size_t i = begin;
+		for (; i + 4 <= end; i += 4) {
+			v128_t m = free_mask(&P.frozen[i]);
+			auto axis = [&](float *p, float *o, float *v, float *a, v128_t e) {
+				v128_t x = ld(p), vel = ld(v), a_in = ld(a);
+				v128_t nv = wasm_f32x4_mul(
+				    wasm_f32x4_add(vel, wasm_f32x4_mul(wasm_f32x4_add(a_in, e), vdt)),
+				    damp);
+				v128_t nx =
+				    wasm_f32x4_add(x, wasm_f32x4_mul(Symplectic ? nv : vel, vdt));
+				st(p, wasm_v128_bitselect(nx, x, m));
+				st(o, wasm_v128_bitselect(nx, ld(o), m));
+				st(v, wasm_v128_bitselect(nv, vel, m));
+				st(a, wasm_v128_bitselect(zero, a_in, m));
+			};
+			axis(&P.px[i], &P.ox[i], &P.vx[i], &P.ax[i], e.x);
+			axis(&P.py[i], &P.oy[i], &P.vy[i], &P.ay[i], e.y);
+			axis(&P.pz[i], &P.oz[i], &P.vz[i], &P.az[i], e.z);
+		}
+		return i;
+	}
+	std::size_t integrate_explicit_euler_simd(float dt, std::size_t begin,
+	                                          std::size_t end, Vec3 ext) {
+		return integrate_euler_simd<false>(dt, begin, end, ext);
+	}
+	std::size_t integrate_symplectic_euler_simd(float dt, std::size_t begin,
+	                                            std::size_t end, Vec3 ext) {
+		return integrate_euler_simd<true>(dt, begin, end, ext);
+	}
+#endif
+};
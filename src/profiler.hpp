@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// build with SIM_PROFILE=1 to time the phases of PhysicsWorld::step. without
+// it every call below is empty and the clock is never read
+#ifndef SIM_PROFILE
+#define SIM_PROFILE 0
+#endif
+
+enum ProfilePhase : std::uint32_t {
+	PHASE_FORCES,    // gravity and wind, only implicit euler has a pass of its own
+	PHASE_SPRINGS,   // solve_springs and the xpbd projection
+	PHASE_INTEGRATE, // the integrators, with rk's springs and the fused colliders
+	PHASE_CONTACTS,  // self collision, and colliders the integrator didn't take
+	PHASE_UPKEEP,    // tearing and sleeping, once per step
+	PHASE_EXPORT,    // the render view
+	PHASE_COUNT
+};
+
+enum ProfileCounter : std::uint32_t {
+	COUNTER_STEPS,     // fixed steps
+	COUNTER_SUB_STEPS, // substeps over all of them
+	COUNTER_SPRINGS,   // springs visited by PHASE_SPRINGS
+	COUNTER_PINNED,    // particles skipped as pinned, at the end of the frame
+	COUNTER_SLEEPING,  // particles skipped as asleep (and not pinned)
+	COUNTER_COUNT
+};
+
+// the stats view, floats. per phase last, mean and max milliseconds over the
+// window, then the counters of the last frame, then the frames in the window
+constexpr std::size_t STATS_PHASE_STRIDE = 3;
+constexpr std::size_t STATS_COUNTERS = PHASE_COUNT * STATS_PHASE_STRIDE;
+constexpr std::size_t STATS_FRAMES = STATS_COUNTERS + COUNTER_COUNT;
+constexpr std::size_t STATS_SIZE = STATS_FRAMES + 1;
+
+// per frame phase timings kept in a ring of HISTORY frames. a frame runs from
+// the first begin_frame to the next end_frame, so an advance that doesn't get
+// exported folds into the next one. time is exclusive: a phase inside another
+// pauses the outer one, the phases of a frame add up to its cost.
+// single threaded, the stepping thread owns it
+class Profiler {
+public:
+	static constexpr bool enabled = SIM_PROFILE != 0;
+	static constexpr std::size_t HISTORY = 128;
+
+#if SIM_PROFILE
+	class Scope {
+		Profiler &prof;
+		std::uint32_t outer;
+
+	public:
+		Scope(Profiler &p, ProfilePhase phase) : prof(p), outer(p.enter(phase)) {}
+		~Scope() {
+			prof.enter(outer);
+		}
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+	};
+#else
+	// the empty destructor keeps -Wunused quiet about the named timers
+	struct Scope {
+		Scope(Profiler &, ProfilePhase) {}
+		~Scope() {}
+	};
+#endif
+
+	// auto t = profile.time(PHASE_X); times the rest of the block
+	[[nodiscard]] auto time(ProfilePhase phase) -> Scope {
+		return {*this, phase};
+	}
+
+	void count(ProfileCounter c, std::uint64_t n) {
+		if constexpr (enabled)
+			counters[c] += n;
+	}
+	void set(ProfileCounter c, std::uint64_t n) {
+		if constexpr (enabled)
+			counters[c] = n;
+	}
+
+	void begin_frame() {
+		if constexpr (enabled) {
+			if (open)
+				return;
+			open = true;
+			current.fill(0.0f);
+			counters.fill(0);
+		}
+	}
+	void end_frame() {
+		if constexpr (enabled) {
+			if (!open)
+				return;
+			open = false;
+			// a phase still running is charged up to here
+			enter(active);
+			history[cursor] = current;
+			cursor = (cursor + 1) % HISTORY;
+			frames = std::min(frames + 1, HISTORY);
+			summarize();
+		}
+	}
+
+	auto stats() const -> const float * {
+		return view.data();
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+	static constexpr std::uint32_t NONE = PHASE_COUNT;
+
+	std::array<float, PHASE_COUNT + 1> current{}; // NONE collects untimed time
+	std::array<std::uint64_t, COUNTER_COUNT> counters{};
+	std::array<std::array<float, PHASE_COUNT + 1>, HISTORY> history{};
+	std::size_t cursor = 0;
+	std::size_t frames = 0;
+	bool open = false;
+	std::uint32_t active = NONE;
+	clock::time_point mark;
+	std::array<float, STATS_SIZE> view{};
+
+	// charges the running phase up to now and switches to phase, returns the
+	// one that was running
+	auto enter(std::uint32_t phase) -> std::uint32_t {
+		const auto now = clock::now();
+		current[active] += std::chrono::duration<float, std::milli>(now - mark).count();
+		mark = now;
+		const std::uint32_t was = active;
+		active = phase;
+		return was;
+	}
+
+	void summarize() {
+		const float *last = history[(cursor + HISTORY - 1) % HISTORY].data();
+		for (std::size_t p = 0; p < PHASE_COUNT; ++p) {
+			float sum = 0.0f, peak = 0.0f;
+			for (std::size_t f = 0; f < frames; ++f) {
+				sum += history[f][p];
+				peak = std::max(peak, history[f][p]);
+			}
+			float *out = &view[p * STATS_PHASE_STRIDE];
+			out[0] = last[p];
+			out[1] = sum / frames;
+			out[2] = peak;
+		}
+		for (std::size_t c = 0; c < COUNTER_COUNT; ++c)
+			view[STATS_COUNTERS + c] = static_cast<float>(counters[c]);
+		view[STATS_FRAMES] = static_cast<float>(frames);
+	}
+};
@@ -0,0 +1,112 @@
+// ring of persistent MAP_READ staging buffers. every interval frames the
+// selected regions are copied into a free slot on the frame's own encoder,
+// and the slot is mapped once that frame is submitted. if every slot is still
+// in flight the collection is skipped instead of waiting, so the gpu never
+// stalls on js and js never awaits the gpu inside a frame
+
+export type ReadbackRegion = {
+  // picked at record time, for ping-ponged buffers
+  source: () => GPUBuffer;
+  offset: number;
+  size: number;
+};
+
+export type ReadbackResult = {
+  // frame number passed to record()
+  frame: number;
+  // one copy per region, in the order they were given
+  regions: ArrayBuffer[];
+};
+
+type Slot = {
+  buffer: GPUBuffer;
+  state: 'idle'|'recorded'|'mapping';
+  frame: number;
+};
+
+export class ReadbackRing {
+  private readonly slots: Slot[];
+  private readonly offsets: number[];
+  private readonly listeners = new Set<(r: ReadbackResult) => void>();
+  private disposed = false;
+  // collections skipped because every slot was busy
+  dropped = 0;
+
+  constructor(
+      device: GPUDevice, private readonly regions: ReadbackRegion[],
+      public interval = 4, slotCount = 3) {
+    let size = 0;
+    this.offsets = regions.map(r => {
+      const at = size;
+      size += Math.ceil(r.size / 4) * 4;
+      return at;
+    });
+    this.slots = Array.from(
+        {length: Math.max(2, slotCount)},
+        () => ({
+          buffer: device.createBuffer({
+            size: Math.max(size, 4),
+            usage: GPUBufferUsage.COPY_DST | GPUBufferUsage.MAP_READ
+          }),
+          state: 'idle' as const,
+          frame: 0
+        }));
+  }
+
+  // returns the unsubscribe function
+  subscribe(cb: (r: ReadbackResult) => void) {
+    this.listeners.add(cb);
+    return () => {
+      this.listeners.delete(cb);
+    };
+  }
+
+  // whether record() will copy this frame, so producers can skip the
+  // passes that only exist for the readback
+  due(frame: number) {
+    return this.listeners.size > 0 && frame % this.interval === 0;
+  }
+
+  // call with the frame's encoder after the passes that produce the state
+  record(encoder: GPUCommandEncoder, frame: number) {
+    if (!this.due(frame)) return;
+    const slot = this.slots.find(s => s.state === 'idle');
+    if (!slot) {
+      this.dropped++;
+      return;
+    }
+    this.regions.forEach((r, i) => {
+      encoder.copyBufferToBuffer(
+          r.source(), r.offset, slot.buffer, this.offsets[i], r.size);
+    });
+    slot.state = 'recorded';
+    slot.frame = frame;
+  }
+
+  // call right after queue.submit of the encoder given to record()
+  submitted() {
+    for (const slot of this.slots) {
+      if (slot.state !== 'recorded') continue;
+      slot.state = 'mapping';
+      slot.buffer.mapAsync(GPUMapMode.READ).then(() => {
+        if (this.disposed) return;
+        const mapped = slot.buffer.getMappedRange();
+        const regions = this.regions.map(
+            (r, i) => mapped.slice(this.offsets[i], this.offsets[i] + r.size));
+        slot.buffer.unmap();
+        slot.state = 'idle';
+        const result = {frame: slot.frame, regions};
+        this.listeners.forEach(cb => cb(result));
+      }, () => {
+        // device lost or buffer destroyed while mapping
+        slot.state = 'idle';
+      });
+    }
+  }
+
+  dispose() {
+    this.disposed = true;
+    this.listeners.clear();
+    this.slots.forEach(s => s.buffer.destroy());
+  }
+}
@@ -23,32 +23,424 @@ export interface PhysicsWorld {
       k: number, damp: number): void;
 
   /**
-   * Returns a pointer (number) to the start of the Particle array in the HEAP
+   * Sizes the createMesh input. Then write vertexCount xyz floats at
+   * getMeshVertexPtr() and triangleCount * 3 Uint32 indices at
+   * getMeshIndexPtr(), e.g. HEAPF32.set(positions, ptr >> 2). The buffers
+   * are kept between meshes and move on beginMesh or memory growth.
+   */
+  beginMesh(vertexCount: number, triangleCount: number): void;
+  getMeshVertexPtr(): number;
+  getMeshIndexPtr(): number;
+  /**
+   * Replaces the cloth with the beginMesh triangles, positions in render
+   * space (y up) like getPPtr(). Every unique triangle edge becomes a spring
+   * with stiffness k; bendK > 0 also joins the two corners across each edge
+   * shared by two triangles. Nothing starts pinned and the mesh doesn't
+   * sleep (tiles need the createCloth grid).
+   */
+  createMesh(k: number, damp: number, bendK: number): void;
+
+  /**
+   * Returns a pointer (number) to the interleaved particle view in the HEAP.
+   * The view holds P_STRIDE floats per particle, see SimModule.P_* for the
+   * field offsets. Positions are in render space (y already flipped) and each
+   * record is a vec4, so the whole range can be uploaded to the GPU as is.
+   * It is refreshed at the end of every update() and only moves on
+   * createCloth or memory growth.
    */
   getPPtr(): number;
-  /** Returns a pointer (number) to the start of the Spring array in the HEAP */
+  /**
+   * Returns a pointer (number) to the start of the Spring array in the HEAP,
+   * 6 x 4 bytes each: p1, p2 (int32), rest length, k, damp, tear strain.
+   * Torn springs stay in the array with k = damp = 0, see getBatchEnd().
+   */
   getSPtr(): number;
   /** Returns the number of active particles */
   getPCount(): number;
-  /** Returns the number of active springs */
+  /** Returns the number of springs, torn ones included */
   getSCount(): number;
+  /**
+   * Returns the number of spring colour batches. Springs in getSPtr() are
+   * sorted by batch and no two springs in a batch share a particle.
+   */
+  getBatchCount(): number;
+  /**
+   * Batch b's live springs end here (exclusive), torn ones fill the rest of
+   * the batch up to where the next one starts.
+   */
+  getBatchEnd(batch: number): number;
+  /**
+   * Springs break once stretched past strain * rest length (0.5 = 50%).
+   * jitter in 0..1 spreads the threshold per spring, deterministically for
+   * the same cloth. strain 0 turns tearing off. Checked once per fixed step,
+   * torn springs drop out of the CSR as well.
+   */
+  setTearStrain(strain: number, jitter: number): void;
+  /** Threshold of one live spring by its getSPtr() index, 0 = unbreakable */
+  setSpringTear(index: number, strain: number): void;
+  /** Springs torn since the last createCloth */
+  getBrokenCount(): number;
+  /**
+   * The createCloth grid sleeps in 8x8 tiles: a tile whose mean kinetic
+   * energy per free particle stays under energy for steps fixed steps in a row
+   * stops and is skipped by the solvers until something wakes it (a moving
+   * neighbour tile, setParticlePos, setPinned, pickParticle, a collider
+   * moving over it, gravity/wind/spring changes). energy 0 (the default) turns
+   * sleeping off.
+   */
+  setSleepThreshold(energy: number, steps: number): void;
+  /** Tiles currently asleep */
+  getSleepingTiles(): number;
+  /**
+   * Kinetic + spring + gravity/wind potential energy of the free particles.
+   * Only meant for drift checks, it walks every particle and spring.
+   */
+  getEnergy(): number;
+
+  /**
+   * CSR spring topology. Row i spans [offsets[i], offsets[i + 1]) into the
+   * indices (Uint32, neighbour particle) and data (4 floats per entry:
+   * rest length, k, damp, tear strain) arrays. offsets has getPCount() + 1
+   * entries, indices/data have getAdjCount() entries. Pointers are byte offsets into
+   * the HEAP and stay valid until the next createCloth. Tearing rewrites the
+   * contents in place and shrinks getAdjCount().
+   */
+  getAdjOffsetsPtr(): number;
+  getAdjIndicesPtr(): number;
+  getAdjDataPtr(): number;
+  getAdjCount(): number;
 
   setParticlePos(index: number, x: number, y: number, z: number): void;
+  /**
+   * Byte offset of a float scratch at least floats long that the *Range
+   * calls read from (or getPinnedRange writes to), so a whole range costs one
+   * call instead of one per element. Stays put until a longer one is asked
+   * for. Ranges are clamped to the particles/springs and to the scratch.
+   */
+  getUploadPtr(floats: number): number;
+  /** One float per particle, nonzero pins */
+  setPinnedRange(first: number, count: number): void;
+  /** 1.0 / 0.0 per particle, written to the start of the upload scratch */
+  getPinnedRange(first: number, count: number): void;
+  /** setParticlePos for count particles, xyz each, sim space */
+  setPositionsRange(first: number, count: number): void;
+  /** One mass per particle, clamped to 0.1 like setMass */
+  setMassesRange(first: number, count: number): void;
+  /** (k, damp) per spring by getSPtr() index, torn springs stay torn */
+  setSpringsRange(first: number, count: number): void;
 
   setGravity(x: number, y: number, z: number): void;
   setWind(x: number, y: number, z: number): void;
   setDamping(damping: number): void;
   setSubSteps(steps: number): void;
+  /**
+   * Picks the substep count every step instead: the stiffest spring row and
+   * the fastest strain rate of the previous step bound the substep length,
+   * courant (0..1) scales it down. maxSteps 0 goes back to setSubSteps.
+   * The 0.05 s cap on the substep length only applies to the fixed count.
+   */
+  setAdaptiveSubSteps(minSteps: number, maxSteps: number, courant: number):
+      void;
+  /** Substeps the last fixed step ran with */
+  getSubSteps(): number;
+  /**
+   * setSpringParams and setMass broadcast one value to every spring or
+   * particle. Repeating the value they last set is free, unless a *Range call
+   * has overridden it in between.
+   */
   setSpringParams(k: number, damp: number): void;
 
   setMass(mass: number): void;
   setPinned(index: number, pinned: boolean): void;
   setSolver(type: number): void;
   isPinned(index: number): boolean;
+  /**
+   * Returns the particle nearest to a render space ray that lies within
+   * radius of it (closest along the ray wins), or -1.
+   */
+  pickParticle(
+      ox: number, oy: number, oz: number, dx: number, dy: number, dz: number,
+      radius: number): number;
   setPinned(index: number, pinned: boolean): void;
+  /**
+   * Physics step length in seconds. update() runs as many whole steps as the
+   * accumulated frame time allows and carries the remainder.
+   */
   setFixedDt(deltatime: number): void;
-  setSimDt(deltatime:number):void;
-  set_use_ticks(use:boolean):void;
+  /** Most steps a single update() may run, the rest of the backlog is dropped */
+  setMaxSteps(steps: number): void;
+  /**
+   * Leftover accumulator time as a fraction of a step. getPPtr() is already
+   * blended between the last two steps by this amount.
+   */
+  getAlpha(): number;
+  /** Switches between the simd128 and scalar kernels, no-op without SIMD */
+  setUseSimd(use: boolean): void;
+  /** True when the module was built with SIM_SIMD (-msimd128) */
+  hasSimd(): boolean;
+  /**
+   * STATS_SIZE floats of per phase timings and counters, refreshed by every
+   * update. Per phase (in PROFILE_PHASES order: forces, springs, integrate,
+   * contacts, upkeep, export) the last, mean and max milliseconds over the
+   * last 128 frames, STATS_PHASE_STRIDE floats each; then PROFILE_COUNTERS
+   * counters of the last frame from STATS_COUNTERS (steps, substeps, springs
+   * visited, pinned and sleeping particles); then at STATS_FRAMES the frames
+   * the window holds. All zero unless hasProfiler().
+   */
+  getStatsPtr(): number;
+  /** True when the module was built with SIM_PROFILE */
+  hasProfiler(): boolean;
+  /**
+   * Constraint passes per substep for the XPBD solver (8). Default 1, more
+   * substeps are usually the better trade than more iterations.
+   */
+  setXpbdIterations(iterations: number): void;
+  /**
+   * Caps the conjugate gradient solve used by the implicit euler solver.
+   * tolerance is relative to the initial residual. Defaults: 32, 1e-3.
+   */
+  setCgParams(maxIters: number, tolerance: number): void;
+  /** Iterations the last implicit euler substep needed. */
+  getCgIterations(): number;
+  /**
+   * Pushes apart particles closer than 2 * radius that aren't joined by a
+   * spring, using a spatial hash rebuilt every substep. Off by default.
+   */
+  setSelfCollision(enabled: boolean): void;
+  /** Contact radius per particle for self collision, default 5 */
+  setCollisionRadius(radius: number): void;
+  /**
+   * Spatial hash cell size and bucket count (rounded up to a power of two).
+   * 0 picks the defaults: cell = 4 * radius (also the minimum), buckets =
+   * 2 * particle count.
+   */
+  setHashParams(cellSize: number, tableSize: number): void;
+  /**
+   * Colliders are resolved after every substep, in sim space like
+   * createCloth (y down). Planes and SDF grids have no thickness.
+   * Each add* returns the collider id, ids are indices into
+   * getColliderPtr() and stay valid until clearColliders(). A new world
+   * starts with the floor plane (0, -1, 0) at offset -900.
+   */
+  addSphere(x: number, y: number, z: number, radius: number): number;
+  addCapsule(
+      ax: number, ay: number, az: number, bx: number, by: number, bz: number,
+      radius: number): number;
+  /** Keeps particles on the side where dot(n, x) >= offset */
+  addPlane(nx: number, ny: number, nz: number, offset: number): number;
+  /**
+   * Signed distance grid with nx * ny * nz samples spaced cell apart from the
+   * origin, negative inside. Starts out empty (a large finite distance),
+   * write the distances through getSdfPtr(id).
+   */
+  addSdfGrid(
+      ox: number, oy: number, oz: number, nx: number, ny: number, nz: number,
+      cell: number): number;
+  /**
+   * Byte offset of the grid's floats in the HEAP, x fastest, 0 if id isn't a
+   * grid. Moves whenever another grid is added.
+   */
+  getSdfPtr(id: number): number;
+  /** All grids back to back, COLLIDER_STRIDE records index into this */
+  getSdfPoolPtr(): number;
+  getSdfPoolSize(): number;
+  /**
+   * Moves a collider to the point (sphere centre, first capsule end with the
+   * second following, grid origin). Planes are shifted to pass through it.
+   */
+  setColliderPos(id: number, x: number, y: number, z: number): void;
+  /**
+   * friction: share of tangential velocity lost on contact, restitution:
+   * share of normal velocity bounced back. Both 0..1, default 0.
+   */
+  setColliderMaterial(id: number, friction: number, restitution: number):
+      void;
+  /** Removes every collider, the default floor included */
+  clearColliders(): void;
+  /**
+   * Packed colliders, COLLIDER_STRIDE floats each, see colliders.hpp for the
+   * layout. Matches the Collider struct in shaders.slang so it can be copied
+   * to the GPU as is. Moves when a collider is added.
+   */
+  getColliderPtr(): number;
+  getColliderCount(): number;
+  /**
+   * Sets the number of threads (including the calling one) used by update().
+   * 1 keeps everything on the calling thread.
+   */
+  setThreadCount(count: number): void;
+  getThreadCount(): number;
+  /**
+   * Keeps every reduction on a fixed partition, so the same build, snapshot
+   * and sequence of calls (update dt included) give the same bits whatever
+   * the thread count. Off by default, only the implicit solver pays for it.
+   */
+  setDeterministic(deterministic: boolean): void;
+  /**
+   * Versioned binary copy of the whole simulation: particle state, springs
+   * and batches, colliders and SDF grids, sleeping and every parameter. The
+   * thread count is not part of it. Snapshots only load into the same build.
+   */
+  getSnapshotSize(): number;
+  /**
+   * Writes the snapshot to ptr (a HEAP byte offset, e.g. getUploadPtr), 0 if
+   * capacity is too small. Returns the bytes written.
+   */
+  saveSnapshot(ptr: number, capacity: number): number;
+  /**
+   * Replaces the world with a saveSnapshot buffer of size bytes. Returns
+   * false, leaving the world as it was, if it isn't a whole snapshot from
+   * this build. getPPtr() moves if the particle count changed.
+   */
+  restoreSnapshot(ptr: number, size: number): boolean;
+  delete(): void;
+}
+
+/**
+ * Many independent cloths stepped by one update() and exported into one
+ * view. Each cloth is its own single threaded world with its own parameters
+ * and colliders, the batch spreads whole worlds across its threads. World ids
+ * count up from 0 in addCloth order and stay valid until clear(); calls that
+ * take a world id apply to every world when it is -1.
+ * Warning: You must manually call .delete() when finished to free C++ memory.
+ */
+export interface WorldBatch {
+  /** Same arguments as PhysicsWorld.createCloth, returns the world id */
+  addCloth(
+      sx: number, sy: number, sz: number, w: number, h: number, sep: number,
+      k: number, damp: number): number;
+  clear(): void;
+  getWorldCount(): number;
+  update(dt: number): void;
+
+  /**
+   * Every world's particles back to back in the PhysicsWorld.getPPtr()
+   * layout. Moves on addCloth, clear and memory growth.
+   */
+  getPPtr(): number;
+  getPCount(): number;
+  /** First particle of a world in getPPtr() */
+  getWorldOffset(world: number): number;
+  getWorldPCount(world: number): number;
+  /** PhysicsWorld.getStatsPtr of one world, 0 for a bad id */
+  getStatsPtr(world: number): number;
+  /**
+   * LOD_STRIDE floats per world, see SimModule.LOD_*: the grid of the level
+   * being stepped and a bounding sphere of it in render space. A coarser
+   * level fills only the first w * h records of the world's range in
+   * getPPtr(). Refreshed by update(), moves on addCloth and clear.
+   */
+  getLodPtr(): number;
+  /**
+   * Every cloth also has coarser copies of its grid, level l with about
+   * every 2^l-th row and column of the same sheet. Only the current level is
+   * stepped, switching resamples its state. 0 is the full grid.
+   */
+  getLevelCount(world: number): number;
+  getLevel(world: number): number;
+  setLevel(world: number, level: number): void;
+  getAlpha(): number;
+  /** Shared by every world so they stay on the same frame */
+  setFixedDt(deltatime: number): void;
+  setMaxSteps(steps: number): void;
+  /** Threads across worlds, a single world never runs on more than one */
+  setThreadCount(count: number): void;
+  getThreadCount(): number;
+
+  setGravity(world: number, x: number, y: number, z: number): void;
+  setWind(world: number, x: number, y: number, z: number): void;
+  setDamping(world: number, damping: number): void;
+  setSolver(world: number, type: number): void;
+  setSubSteps(world: number, steps: number): void;
+  setSpringParams(world: number, k: number, damp: number): void;
+  /** Per particle of the full grid, coarser levels scale it with the cell */
+  setMass(world: number, mass: number): void;
+  setSleepThreshold(world: number, energy: number, steps: number): void;
+  /**
+   * index is the particle in the full grid of the world, not in getPPtr().
+   * Coarser levels apply it to their nearest particle.
+   */
+  setPinned(world: number, index: number, pinned: boolean): void;
+  setParticlePos(
+      world: number, index: number, x: number, y: number, z: number): void;
+
+  /**
+   * Same as the PhysicsWorld colliders, per world. Returns the collider id
+   * in the (last) world it was added to, -1 if world matched none.
+   */
+  addSphere(world: number, x: number, y: number, z: number, radius: number):
+      number;
+  addCapsule(
+      world: number, ax: number, ay: number, az: number, bx: number,
+      by: number, bz: number, radius: number): number;
+  addPlane(world: number, nx: number, ny: number, nz: number, offset: number):
+      number;
+  setColliderPos(
+      world: number, id: number, x: number, y: number, z: number): void;
+  clearColliders(world: number): void;
+  delete(): void;
+}
+
+/**
+ * One PhysicsWorld stepped in real time on a thread of its own. Finished
+ * frames come out of a triple buffer, inputs go into a command queue, so
+ * neither side ever waits for the other. Topology is only built while
+ * stopped. The setters return false when the queue was full and the command
+ * got dropped.
+ * Warning: You must manually call .delete() when finished to free C++ memory.
+ */
+export interface SimHost {
+  /** Same arguments as PhysicsWorld.createCloth, false while running */
+  createCloth(
+      sx: number, sy: number, sz: number, w: number, h: number, sep: number,
+      k: number, damp: number): boolean;
+  getPCount(): number;
+  start(): void;
+  /** Joins the host thread, commands still queued are applied */
+  stop(): void;
+  isRunning(): boolean;
+
+  /**
+   * Newest finished frame in the PhysicsWorld.getPPtr() layout. Holds still
+   * until the next acquire(); moves with memory growth like any heap view.
+   */
+  acquire(): number;
+  /** Fixed steps the acquired frame is at */
+  getFrame(): number;
+  /** PhysicsWorld.getStatsPtr as of the acquired frame */
+  getStatsPtr(): number;
+  hasProfiler(): boolean;
+  /** Same as PhysicsWorld.pickParticle, against the acquired frame */
+  pickParticle(
+      ox: number, oy: number, oz: number, dx: number, dy: number, dz: number,
+      radius: number): number;
+  /** As of the acquired frame */
+  isPinned(index: number): boolean;
+
+  setGravity(x: number, y: number, z: number): boolean;
+  setWind(x: number, y: number, z: number): boolean;
+  setDamping(damping: number): boolean;
+  setSubSteps(steps: number): boolean;
+  setSpringParams(k: number, damp: number): boolean;
+  setMass(mass: number): boolean;
+  setSolver(type: number): boolean;
+  setPinned(index: number, pinned: boolean): boolean;
+  /** Simulation space, y down */
+  setParticlePos(index: number, x: number, y: number, z: number): boolean;
+  /** Real time multiplier, 0 pauses */
+  setTimeScale(scale: number): boolean;
+  setFixedDt(deltatime: number): boolean;
+  setMaxSteps(steps: number): boolean;
+  /** Worker threads of the world itself, on top of the host thread */
+  setThreadCount(count: number): boolean;
+  setXpbdIterations(iterations: number): boolean;
+  setSelfCollision(enabled: boolean): boolean;
+  setCollisionRadius(radius: number): boolean;
+  setSleepThreshold(energy: number, steps: number): boolean;
+  setUseSimd(enabled: boolean): boolean;
+  setColliderPos(id: number, x: number, y: number, z: number): boolean;
+  /** Commands dropped on a full queue so far */
+  getDropped(): number;
   delete(): void;
 }
 
@@ -58,6 +450,35 @@ export interface PhysicsWorld {
 export interface SimModule extends EmscriptenModule {
   // Constructor signature for the C++ class
   PhysicsWorld: new() => PhysicsWorld;
+  WorldBatch: new() => WorldBatch;
+  SimHost: new() => SimHost;
+
+  /** Floats per particle in the getPPtr() view */
+  readonly P_STRIDE: number;
+  /** Float offsets of each field inside one getPPtr() record */
+  readonly P_X: number;
+  readonly P_Y: number;
+  readonly P_Z: number;
+  /** 1.0 when the particle is pinned, 0.0 otherwise */
+  readonly P_PINNED: number;
+  /** Floats per world in the WorldBatch.getLodPtr() table */
+  readonly LOD_STRIDE: number;
+  /** Float offsets inside one getLodPtr() record, LOD_CENTER is xyz */
+  readonly LOD_FIRST: number;
+  readonly LOD_W: number;
+  readonly LOD_H: number;
+  readonly LOD_LEVEL: number;
+  readonly LOD_CENTER: number;
+  readonly LOD_RADIUS: number;
+  /** Floats per collider in the getColliderPtr() list */
+  readonly COLLIDER_STRIDE: number;
+  /** Layout of the getStatsPtr() view, see PhysicsWorld.getStatsPtr */
+  readonly STATS_SIZE: number;
+  readonly STATS_PHASE_STRIDE: number;
+  readonly STATS_COUNTERS: number;
+  readonly STATS_FRAMES: number;
+  readonly PROFILE_PHASES: number;
+  readonly PROFILE_COUNTERS: number;
 }
 
 /**
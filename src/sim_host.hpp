@@ -0,0 +1,346 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+#include "physics_world.hpp"
+
+// runs a PhysicsWorld on a thread of its own in real time, so stepping
+// overlaps with rendering instead of eating the frame. the main thread never
+// touches the world while it runs: inputs go through a single producer /
+// single consumer command ring, finished frames come back through a triple
+// buffer of render views. neither side ever waits on the other.
+//
+// triple buffer: the host exports into its back slot and swaps it with the
+// middle one, flagging it FRESH. acquire swaps the reader's front slot with
+// the middle one when it is fresh, so the front slot belongs to the reader
+// alone and always holds a whole frame. under pthreads the heap is a
+// SharedArrayBuffer, js reads the front slot in place
+class SimHost {
+public:
+	static constexpr std::uint32_t QUEUE_SIZE = 1024; // power of two
+
+	SimHost() = default;
+	~SimHost() {
+		stop();
+	}
+	SimHost(const SimHost &) = delete;
+	SimHost &operator=(const SimHost &) = delete;
+
+	// topology only changes while stopped, the slots are sized here
+	auto create_cloth(float sx, float sy, float sz, int w, int h, float sep,
+	                  float k, float damp) -> bool {
+		if (running.load(std::memory_order_relaxed))
+			return false;
+		world.create_cloth(sx, sy, sz, w, h, sep, k, damp);
+		const std::size_t n = std::size_t(world.get_p_count()) * VIEW_STRIDE;
+		for (auto &s : slots) {
+			s.assign(n, 0.0f);
+			world.export_view_to(s.data());
+		}
+		slot_frame.fill(0);
+		for (auto &s : slot_stats)
+			s.fill(0.0f);
+		frame = 0;
+		return true;
+	}
+	auto get_p_count() const -> int {
+		return slots[0].size() / VIEW_STRIDE;
+	}
+
+	void start() {
+		if (running.exchange(true))
+			return;
+		thread = std::thread([this] { run(); });
+	}
+	void stop() {
+		if (!running.exchange(false))
+			return;
+		thread.join();
+		// whatever was queued after the last drain still applies
+		drain();
+	}
+	auto is_running() const -> bool {
+		return running.load(std::memory_order_relaxed);
+	}
+
+	// the newest finished frame, VIEW_STRIDE floats per particle like
+	// PhysicsWorld::get_p_ptr. stays readable until the next acquire
+	auto acquire() -> uintptr_t {
+		if (middle.load(std::memory_order_relaxed) & FRESH)
+			front = middle.exchange(front, std::memory_order_acq_rel) & SLOT_MASK;
+		return (uintptr_t)slots[front].data();
+	}
+	// fixed steps the acquired frame is at
+	auto get_frame() const -> int {
+		return static_cast<int>(slot_frame[front]);
+	}
+	// PhysicsWorld::get_stats_ptr as of the acquired frame, copied with it
+	auto get_stats_ptr() const -> uintptr_t {
+		return (uintptr_t)slot_stats[front].data();
+	}
+	auto has_profiler() const -> bool {
+		return Profiler::enabled;
+	}
+
+	// PhysicsWorld::pick_particle against the acquired frame, render space
+	auto pick_particle(float ox, float oy, float oz, float dx, float dy, float dz,
+	                   float radius) const -> int {
+		const float *v = slots[front].data();
+		const float r_sq = radius * radius;
+		float best_t = INFINITY;
+		int best = -1;
+		for (int i = 0; i < get_p_count(); ++i, v += VIEW_STRIDE) {
+			const Vec3 rel{v[VIEW_X] - ox, v[VIEW_Y] - oy, v[VIEW_Z] - oz};
+			const float t = rel.x * dx + rel.y * dy + rel.z * dz;
+			if (t < 0.0f || t >= best_t)
+				continue;
+			if (rel.dot(rel) - t * t <= r_sq) {
+				best_t = t;
+				best = i;
+			}
+		}
+		return best;
+	}
+	// as of the acquired frame, a set_pinned still in the queue isn't in it
+	auto is_pinned(int i) const -> bool {
+		return i >= 0 && i < get_p_count() &&
+		       slots[front][std::size_t(i) * VIEW_STRIDE + VIEW_PINNED] > 0.5f;
+	}
+
+	// inputs, applied by the host before its next step. false when the ring
+	// is full and the command was dropped
+	auto set_gravity(float x, float y, float z) -> bool {
+		return push({OP_GRAVITY, 0, {x, y, z}});
+	}
+	auto set_wind(float x, float y, float z) -> bool {
+		return push({OP_WIND, 0, {x, y, z}});
+	}
+	auto set_damping(float d) -> bool {
+		return push({OP_DAMPING, 0, {d}});
+	}
+	auto set_sub_steps(int steps) -> bool {
+		return push({OP_SUB_STEPS, steps, {}});
+	}
+	auto set_spring_params(float k, float damp) -> bool {
+		return push({OP_SPRING_PARAMS, 0, {k, damp}});
+	}
+	auto set_mass(float m) -> bool {
+		return push({OP_MASS, 0, {m}});
+	}
+	auto set_solver(int type) -> bool {
+		return push({OP_SOLVER, type, {}});
+	}
+	auto set_pinned(int i, bool pin) -> bool {
+		return push({OP_PINNED, i, {pin ? 1.0f : 0.0f}});
+	}
+	// sim space, like PhysicsWorld::set_particle_pos
+	auto set_particle_pos(int i, float x, float y, float z) -> bool {
+		return push({OP_PARTICLE_POS, i, {x, y, z}});
+	}
+	auto set_time_scale(float s) -> bool {
+		return push({OP_TIME_SCALE, 0, {s}});
+	}
+	auto set_fixed_dt(float dt) -> bool {
+		return push({OP_FIXED_DT, 0, {dt}});
+	}
+	auto set_max_steps(int n) -> bool {
+		return push({OP_MAX_STEPS, n, {}});
+	}
+	// the world's own pool, on top of the host thread
+	auto set_thread_count(int n) -> bool {
+		return push({OP_THREADS, n, {}});
+	}
+	auto set_xpbd_iterations(int n) -> bool {
+		return push({OP_XPBD_ITERATIONS, n, {}});
+	}
+	auto set_self_collision(bool v) -> bool {
+		return push({OP_SELF_COLLISION, v ? 1 : 0, {}});
+	}
+	auto set_collision_radius(float r) -> bool {
+		return push({OP_COLLISION_RADIUS, 0, {r}});
+	}
+	auto set_sleep_threshold(float energy, int steps) -> bool {
+		return push({OP_SLEEP, steps, {energy}});
+	}
+	auto set_use_simd(bool v) -> bool {
+		return push({OP_USE_SIMD, v ? 1 : 0, {}});
+	}
+	auto set_collider_pos(int id, float x, float y, float z) -> bool {
+		return push({OP_COLLIDER_POS, id, {x, y, z}});
+	}
+	// commands dropped because the ring was full
+	auto get_dropped() const -> int {
+		return dropped;
+	}
+
+private:
+	enum Op : std::uint32_t {
+		OP_GRAVITY,
+		OP_WIND,
+		OP_DAMPING,
+		OP_SUB_STEPS,
+		OP_SPRING_PARAMS,
+		OP_MASS,
+		OP_SOLVER,
+		OP_PINNED,
+		OP_PARTICLE_POS,
+		OP_TIME_SCALE,
+		OP_FIXED_DT,
+		OP_MAX_STEPS,
+		OP_THREADS,
+		OP_XPBD_ITERATIONS,
+		OP_SELF_COLLISION,
+		OP_COLLISION_RADIUS,
+		OP_SLEEP,
+		OP_USE_SIMD,
+		OP_COLLIDER_POS,
+	};
+	struct Command {
+		Op op;
+		int i;
+		float f[3];
+	};
+
+	static constexpr std::uint32_t FRESH = 4;
+	static constexpr std::uint32_t SLOT_MASK = 3;
+
+	PhysicsWorld world;
+	std::thread thread;
+	std::atomic<bool> running{false};
+
+	std::array<AlignedVec<float>, 3> slots;
+	std::array<std::uint64_t, 3> slot_frame{};
+	std::array<std::array<float, STATS_SIZE>, 3> slot_stats{};
+	std::atomic<std::uint32_t> middle{1};
+	std::uint32_t back = 0;  // host side
+	std::uint32_t front = 2; // reader side
+	std::uint64_t frame = 0; // host side
+
+	std::array<Command, QUEUE_SIZE> queue;
+	std::atomic<std::uint32_t> head{0}; // next to apply, host side
+	std::atomic<std::uint32_t> tail{0}; // next free, main thread side
+	int dropped = 0;
+
+	float time_scale = 1.0f;
+	float fixed_dt = 1.0f / 60.0f;
+
+	auto push(const Command &c) -> bool {
+		const std::uint32_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == QUEUE_SIZE) {
+			++dropped;
+			return false;
+		}
+		queue[t & (QUEUE_SIZE - 1)] = c;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// returns how many commands were applied
+	auto drain() -> std::uint32_t {
+		const std::uint32_t first = head.load(std::memory_order_relaxed);
+		const std::uint32_t t = tail.load(std::memory_order_acquire);
+		for (std::uint32_t h = first; h != t; ++h)
+			apply(queue[h & (QUEUE_SIZE - 1)]);
+		head.store(t, std::memory_order_release);
+		return t - first;
+	}
+
+	void apply(const Command &c) {
+		const float *f = c.f;
+		switch (c.op) {
+		case OP_GRAVITY:
+			world.set_gravity(f[0], f[1], f[2]);
+			break;
+		case OP_WIND:
+			world.set_wind(f[0], f[1], f[2]);
+			break;
+		case OP_DAMPING:
+			world.set_damping(f[0]);
+			break;
+		case OP_SUB_STEPS:
+			world.set_sub_steps(c.i);
+			break;
+		case OP_SPRING_PARAMS:
+			world.set_spring_params(f[0], f[1]);
+			break;
+		case OP_MASS:
+			world.set_mass(f[0]);
+			break;
+		case OP_SOLVER:
+			world.set_solver(c.i);
+			break;
+		case OP_PINNED:
+			world.set_pinned(c.i, f[0] != 0.0f);
+			break;
+		case OP_PARTICLE_POS:
+			world.set_particle_pos(c.i, f[0], f[1], f[2]);
+			break;
+		case OP_TIME_SCALE:
+			time_scale = std::max(0.0f, f[0]);
+			break;
+		case OP_FIXED_DT:
+			world.set_fixed_dt(f[0]);
+			fixed_dt = std::max(1e-4f, f[0]);
+			break;
+		case OP_MAX_STEPS:
+			world.set_max_steps(c.i);
+			break;
+		case OP_THREADS:
+			world.set_thread_count(c.i);
+			break;
+		case OP_XPBD_ITERATIONS:
+			world.set_xpbd_iterations(c.i);
+			break;
+		case OP_SELF_COLLISION:
+			world.set_self_collision(c.i != 0);
+			break;
+		case OP_COLLISION_RADIUS:
+			world.set_collision_radius(f[0]);
+			break;
+		case OP_SLEEP:
+			world.set_sleep_threshold(f[0], c.i);
+			break;
+		case OP_USE_SIMD:
+			world.set_use_simd(c.i != 0);
+			break;
+		case OP_COLLIDER_POS:
+			world.set_collider_pos(c.i, f[0], f[1], f[2]);
+			break;
+		}
+	}
+
+	void publish() {
+		world.export_view_to(slots[back].data());
+		slot_frame[back] = frame;
+		std::copy_n((const float *)world.get_stats_ptr(), STATS_SIZE,
+		            slot_stats[back].data());
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & SLOT_MASK;
+	}
+
+	// the world accumulates real time itself, so the loop only has to wake
+	// up around every step and publish when something changed
+	void run() {
+		using clock = std::chrono::steady_clock;
+		auto last = clock::now();
+		while (running.load(std::memory_order_acquire)) {
+			const bool poked = drain() > 0;
+			const auto now = clock::now();
+			const float dt = std::chrono::duration<float>(now - last).count();
+			last = now;
+			const int steps = world.advance(dt * time_scale);
+			frame += steps;
+			// a drag while paused still has to show up
+			if (steps > 0 || poked)
+				publish();
+			const float until_next = (1.0f - world.get_alpha()) * fixed_dt;
+			const float wait = time_scale > 0.0f ? until_next / time_scale : fixed_dt;
+			std::this_thread::sleep_for(
+			    std::chrono::duration<float>(std::clamp(wait, 1e-4f, fixed_dt)));
+		}
+	}
+};
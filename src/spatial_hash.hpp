@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+// uniform grid hashed into a fixed power of two table, rebuilt from scratch
+// with a counting sort. the layout matches the gpu one in shaders.slang:
+// cell_start[h] .. cell_start[h + 1] indexes sorted, which holds the
+// particles of bucket h in ascending order. different cells can share a
+// bucket, so callers still test the real distance
+class SpatialHash {
+public:
+	// cell_size <= 0 uses the caller's minimum, table_size <= 0 sizes the table
+	// from the particle count on every build
+	void configure(float cell, int table) {
+		requested_cell = cell;
+		requested_table = table;
+	}
+
+	// what configure was given, 0 for automatic
+	[[nodiscard]] float requested_cell_size() const {
+		return requested_cell;
+	}
+	[[nodiscard]] int requested_table_size() const {
+		return requested_table;
+	}
+
+	[[nodiscard]] float cell_size() const {
+		return cell;
+	}
+	[[nodiscard]] std::uint32_t table_size() const {
+		return mask + 1;
+	}
+
+	static std::uint32_t hash_cell(int ix, int iy, int iz, std::uint32_t mask) {
+		const auto h = (static_cast<std::uint32_t>(ix) * 73856093u) ^
+		               (static_cast<std::uint32_t>(iy) * 19349663u) ^
+		               (static_cast<std::uint32_t>(iz) * 83492791u);
+		return h & mask;
+	}
+
+	// bucketing is one parallel pass, counting and scattering are single
+	// memory-bound sweeps that keep the order inside a bucket stable
+	void build(const float *px, const float *py, const float *pz, std::size_t n,
+	           float min_cell, ThreadPool &pool) {
+		// cells smaller than the query reach only add buckets to visit
+		cell = std::max(requested_cell, min_cell);
+		inv_cell = 1.0f / std::max(cell, 1e-6f);
+
+		std::uint32_t table = requested_table > 0
+		                          ? static_cast<std::uint32_t>(requested_table)
+		                          : static_cast<std::uint32_t>(2 * n);
+		std::uint32_t pow2 = 64;
+		while (pow2 < table && pow2 < (1u << 24))
+			pow2 <<= 1;
+		mask = pow2 - 1;
+
+		particle_bucket.resize(n);
+		pool.parallel_for(n, [&](std::size_t b, std::size_t e) {
+			for (std::size_t i = b; i < e; ++i)
+				particle_bucket[i] = bucket_of(px[i], py[i], pz[i]);
+		});
+
+		cell_start.assign(pow2 + 1, 0);
+		for (std::size_t i = 0; i < n; ++i)
+			++cell_start[particle_bucket[i] + 1];
+		for (std::uint32_t h = 0; h < pow2; ++h)
+			cell_start[h + 1] += cell_start[h];
+
+		sorted.resize(n);
+		cursor.assign(cell_start.begin(), cell_start.end() - 1);
+		for (std::size_t i = 0; i < n; ++i)
+			sorted[cursor[particle_bucket[i]]++] = static_cast<std::uint32_t>(i);
+	}
+
+	// f(j) for every particle in the buckets covering the box of half size
+	// reach around (x, y, z), each bucket visited once even when cells hash to
+	// the same one. reach must be at most half the cell size, then the box
+	// touches 2 cells per axis (3 at worst from rounding)
+	template <class F>
+	void for_each_near(float x, float y, float z, float reach, F &&f) const {
+		const int x0 = cell_coord(x - reach), x1 = cell_coord(x + reach);
+		const int y0 = cell_coord(y - reach), y1 = cell_coord(y + reach);
+		const int z0 = cell_coord(z - reach), z1 = cell_coord(z + reach);
+		std::uint32_t seen[27];
+		int seen_count = 0;
+		for (int cz = z0; cz <= z1; ++cz)
+			for (int cy = y0; cy <= y1; ++cy)
+				for (int cx = x0; cx <= x1; ++cx) {
+					const std::uint32_t h = hash_cell(cx, cy, cz, mask);
+					if (std::find(seen, seen + seen_count, h) != seen + seen_count)
+						continue;
+					seen[seen_count++] = h;
+					for (std::uint32_t k = cell_start[h]; k < cell_start[h + 1]; ++k)
+						f(sorted[k]);
+				}
+	}
+
+private:
+	float requested_cell = 0.0f;
+	int requested_table = 0;
+	float cell = 1.0f;
+	float inv_cell = 1.0f;
+	std::uint32_t mask = 63;
+
+	std::vector<std::uint32_t> cell_start;
+	std::vector<std::uint32_t> particle_bucket;
+	std::vector<std::uint32_t> sorted;
+	std::vector<std::uint32_t> cursor;
+
+	[[nodiscard]] int cell_coord(float v) const {
+		return static_cast<int>(std::floor(v * inv_cell));
+	}
+	[[nodiscard]] std::uint32_t bucket_of(float x, float y, float z) const {
+		return hash_cell(cell_coord(x), cell_coord(y), cell_coord(z), mask);
+	}
+};
@@ -0,0 +1,252 @@
+import type GUI from 'lil-gui';
+import {ReadbackRing} from './readback.js';
+import type {SimModule} from './sim.js';
+
+// one shape for the wasm profiler (PhysicsWorld.getStatsPtr) and the gpu
+// timestamp queries, so the panel doesn't care which side produced it
+
+export type PhaseStats = {
+  name: string;
+  // milliseconds
+  last: number;
+  mean: number;
+  max: number;
+};
+
+export type SimStats = {
+  phases: PhaseStats[];
+  counters: Record<string, number>;
+};
+
+// ProfilePhase and ProfileCounter order, see profiler.hpp
+const WASM_PHASES =
+    ['forces', 'springs', 'integrate', 'contacts', 'upkeep', 'export'];
+const WASM_COUNTERS = ['steps', 'substeps', 'springs', 'pinned', 'sleeping'];
+
+export const readWasmStats = (wasm: SimModule, ptr: number): SimStats => {
+  const at = ptr >> 2;
+  const v = wasm.HEAPF32.subarray(at, at + wasm.STATS_SIZE);
+  const phases =
+      WASM_PHASES.slice(0, wasm.PROFILE_PHASES).map((name, p) => {
+        const o = p * wasm.STATS_PHASE_STRIDE;
+        return {name, last: v[o], mean: v[o + 1], max: v[o + 2]};
+      });
+  const counters: Record<string, number> = {};
+  WASM_COUNTERS.slice(0, wasm.PROFILE_COUNTERS)
+      .forEach((name, c) => counters[name] = v[wasm.STATS_COUNTERS + c]);
+  return {phases, counters};
+};
+
+export type GpuTimeline = {
+  // the pass to record phase's dispatches into
+  pass: (phase: number) => GPUComputePassEncoder;
+  end: () => void;
+};
+
+// timestamp queries around compute passes. on a timed frame every run of
+// dispatches of one phase gets its own pass that writes its begin and end
+// time, the durations are summed per phase once the resolved queries come
+// back through a ReadbackRing. untimed frames, and devices without
+// timestamp-query, keep everything in one pass like before
+export class GpuProfiler {
+  readonly supported: boolean;
+  enabled = false;
+  private readonly querySet: GPUQuerySet|null = null;
+  private readonly resolve: GPUBuffer|null = null;
+  private readonly ring: ReadbackRing|null = null;
+  // phase of every timed pass, by frame, until its readback lands
+  private readonly pending = new Map<number, number[]>();
+  private readonly history: Float64Array[] = [];
+  private frame = 0;
+  passes = 0;
+
+  constructor(
+      device: GPUDevice, readonly phases: readonly string[],
+      interval = 4, private readonly maxPasses = 256,
+      private readonly historySize = 128) {
+    this.supported = device.features.has('timestamp-query');
+    if (!this.supported) return;
+    this.querySet =
+        device.createQuerySet({type: 'timestamp', count: maxPasses * 2});
+    this.resolve = device.createBuffer({
+      size: maxPasses * 16,
+      usage: GPUBufferUsage.QUERY_RESOLVE | GPUBufferUsage.COPY_SRC
+    });
+    this.ring = new ReadbackRing(
+        device, [{source: () => this.resolve!, offset: 0, size: maxPasses * 16}],
+        interval);
+    this.ring.subscribe(({frame, regions}) => {
+      const order = this.pending.get(frame);
+      // anything older was dropped by the ring
+      for (const f of this.pending.keys())
+        if (f <= frame) this.pending.delete(f);
+      if (!order) return;
+      const t = new BigUint64Array(regions[0]);
+      const ms = new Float64Array(phases.length);
+      order.forEach((phase, i) => {
+        const b = t[i * 2];
+        const e = t[i * 2 + 1];
+        if (e > b) ms[phase] += Number(e - b) / 1e6;
+      });
+      this.history.push(ms);
+      if (this.history.length > this.historySize) this.history.shift();
+      this.passes = order.length;
+    });
+  }
+
+  get interval() {
+    return this.ring ? this.ring.interval : 1;
+  }
+  set interval(n: number) {
+    if (this.ring) this.ring.interval = n;
+  }
+
+  begin(encoder: GPUCommandEncoder): GpuTimeline {
+    const frame = this.frame++;
+    const timed = this.enabled && this.ring !== null && this.ring.due(frame);
+    const order: number[] = [];
+    let pass: GPUComputePassEncoder|null = null;
+    let current = -1;
+    return {
+      pass: (phase: number) => {
+        if (pass && (!timed || phase === current)) return pass;
+        // out of queries, the rest of the frame counts as the last phase
+        if (pass && order.length === this.maxPasses) return pass;
+        pass?.end();
+        current = phase;
+        if (!timed) return pass = encoder.beginComputePass();
+        const i = order.length;
+        order.push(phase);
+        return pass = encoder.beginComputePass({
+          timestampWrites: {
+            querySet: this.querySet!,
+            beginningOfPassWriteIndex: i * 2,
+            endOfPassWriteIndex: i * 2 + 1
+          }
+        });
+      },
+      end: () => {
+        pass?.end();
+        if (!timed || order.length === 0) return;
+        encoder.resolveQuerySet(
+            this.querySet!, 0, order.length * 2, this.resolve!, 0);
+        this.pending.set(frame, order);
+        this.ring!.record(encoder, frame);
+      }
+    };
+  }
+
+  // call right after queue.submit of the encoder given to begin()
+  submitted() {
+    this.ring?.submitted();
+  }
+
+  stats(): SimStats {
+    const n = this.history.length;
+    const last = n > 0 ? this.history[n - 1] : null;
+    const phases = this.phases.map((name, p) => {
+      let sum = 0;
+      let max = 0;
+      for (const ms of this.history) {
+        sum += ms[p];
+        max = Math.max(max, ms[p]);
+      }
+      return {name, last: last ? last[p] : 0, mean: n ? sum / n : 0, max};
+    });
+    return {phases, counters: {passes: this.passes}};
+  }
+
+  dispose() {
+    this.ring?.dispose();
+    this.querySet?.destroy();
+    this.resolve?.destroy();
+  }
+}
+
+const PLOT_COLORS = [
+  '#4e79a7', '#f28e2b', '#e15759', '#76b7b2', '#59a14f', '#edc948', '#b07aa1',
+  '#ff9da7'
+];
+
+// a folder plotting SimStats: the last time of every phase stacked per frame
+// for the recent frames, plus the means and counters as readouts
+export class StatsPanel {
+  private readonly folder: GUI;
+  private readonly canvas = document.createElement('canvas');
+  private readonly samples: number[][] = [];
+  private readonly readout: Record<string, number> = {};
+  private names: string[] = [];
+
+  constructor(gui: GUI, title = 'Profiler', private readonly width = 240,
+              private readonly height = 90) {
+    this.folder = gui.addFolder(title);
+    this.canvas.width = width;
+    this.canvas.height = height;
+    this.canvas.style.cssText = 'display:block;margin:4px auto;';
+    this.folder.$children.appendChild(this.canvas);
+  }
+
+  update(stats: SimStats) {
+    if (this.names.length === 0) {
+      this.names = stats.phases.map(p => p.name);
+      for (const p of stats.phases) this.track(`${p.name} ms`);
+      for (const name of Object.keys(stats.counters)) this.track(name);
+    }
+    for (const p of stats.phases)
+      this.readout[`${p.name} ms`] = Math.round(p.mean * 1000) / 1000;
+    for (const [name, v] of Object.entries(stats.counters))
+      this.readout[name] = v;
+
+    this.samples.push(stats.phases.map(p => p.last));
+    if (this.samples.length > this.width / 2) this.samples.shift();
+    this.draw();
+  }
+
+  private track(name: string) {
+    this.readout[name] = 0;
+    this.folder.add(this.readout, name).listen().disable();
+  }
+
+  private draw() {
+    const ctx = this.canvas.getContext('2d');
+    if (!ctx) return;
+    const {width, height} = this;
+    ctx.fillStyle = '#1f1f1f';
+    ctx.fillRect(0, 0, width, height);
+    let top = 0;
+    for (const s of this.samples)
+      top = Math.max(top, s.reduce((a, b) => a + b, 0));
+    if (top <= 0) return;
+    const legend = 26;
+    const scale = (height - legend) / top;
+    this.samples.forEach((s, x) => {
+      let y = height;
+      s.forEach((ms, p) => {
+        const h = ms * scale;
+        ctx.fillStyle = PLOT_COLORS[p % PLOT_COLORS.length];
+        ctx.fillRect(x * 2, y - h, 2, h);
+        y -= h;
+      });
+    });
+    ctx.font = '10px sans-serif';
+    ctx.textBaseline = 'top';
+    ctx.fillStyle = '#ddd';
+    ctx.fillText(`${top.toFixed(2)} ms`, 2, 1);
+    let x = 60;
+    let y = 1;
+    this.names.forEach((name, p) => {
+      const w = ctx.measureText(name).width;
+      if (x + w > width) {
+        x = 2;
+        y += 12;
+      }
+      ctx.fillStyle = PLOT_COLORS[p % PLOT_COLORS.length];
+      ctx.fillText(name, x, y);
+      x += w + 6;
+    });
+  }
+
+  destroy() {
+    this.folder.destroy();
+  }
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// persistent fork/join pool. workers park on an atomic generation counter and
+// the caller waits on a countdown, so a parallel_for costs two atomic round
+// trips instead of a thread spawn. the caller always runs chunk 0 itself.
+//
+// partitioning is static: [0, n) is cut into size() contiguous chunks whose
+// boundaries are multiples of ALIGN, so simd kernels see whole groups of 4
+// and neighbouring chunks don't share cache lines of the same stream.
+class ThreadPool {
+public:
+	static constexpr std::size_t ALIGN = 16;
+
+	explicit ThreadPool(int threads = 1) {
+		resize(threads);
+	}
+	~ThreadPool() {
+		stop();
+	}
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	// total thread count including the calling thread
+	[[nodiscard]] int size() const {
+		return static_cast<int>(workers.size()) + 1;
+	}
+
+	static int hardware_threads() {
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	void resize(int threads) {
+		threads = std::clamp(threads, 1, 64);
+		if (threads == size())
+			return;
+		stop();
+		quit.store(false, std::memory_order_relaxed);
+		// workers start from the current generation, a thread that gets
+		// scheduled late must still see the first job as new
+		const std::uint32_t start = generation.load(std::memory_order_relaxed);
+		for (int i = 1; i < threads; ++i)
+			workers.emplace_back([this, i, start] { worker_loop(i, start); });
+	}
+
+	// f(begin, end) for every chunk of [0, n). ranges smaller than min_chunk per
+	// thread are not worth the wakeup and run inline
+	template <class F>
+	void parallel_for(std::size_t n, F &&f, std::size_t min_chunk = 1024) {
+		const int chunks = chunk_count(n, min_chunk);
+		if (chunks <= 1) {
+			if (n > 0)
+				f(std::size_t{0}, n);
+			return;
+		}
+		using Fn = std::remove_reference_t<F>;
+		job.fn = [](void *ctx, int, std::size_t b, std::size_t e) {
+			(*static_cast<Fn *>(ctx))(b, e);
+		};
+		job.ctx = const_cast<void *>(static_cast<const void *>(&f));
+		job.n = n;
+		job.chunks = chunks;
+		run();
+	}
+
+	// same partitioning but the callback also gets its chunk index, for
+	// per-chunk partial results that get reduced in order afterwards
+	template <class F>
+	void parallel_chunks(std::size_t n, int chunks, F &&f) {
+		chunks = std::clamp(chunks, 1, size());
+		if (chunks <= 1) {
+			f(0, std::size_t{0}, n);
+			return;
+		}
+		using Fn = std::remove_reference_t<F>;
+		job.fn = [](void *ctx, int c, std::size_t b, std::size_t e) {
+			(*static_cast<Fn *>(ctx))(c, b, e);
+		};
+		job.ctx = const_cast<void *>(static_cast<const void *>(&f));
+		job.n = n;
+		job.chunks = chunks;
+		run();
+	}
+
+	// f(i) for every i in [0, n), handed out one at a time from a shared
+	// counter instead of static chunks. for a handful of uneven tasks (whole
+	// worlds in a WorldBatch) where fixed ranges would leave threads idle
+	template <class F> void parallel_tasks(std::size_t n, F &&f) {
+		const int chunks =
+		    static_cast<int>(std::min<std::size_t>(n, size()));
+		if (chunks <= 1) {
+			for (std::size_t i = 0; i < n; ++i)
+				f(i);
+			return;
+		}
+		struct Ctx {
+			std::remove_reference_t<F> *f;
+			std::size_t n;
+			std::atomic<std::size_t> next{0};
+		} ctx{&f, n};
+		job.fn = [](void *p, int, std::size_t, std::size_t) {
+			auto &c = *static_cast<Ctx *>(p);
+			for (std::size_t i; (i = c.next.fetch_add(
+			                         1, std::memory_order_relaxed)) < c.n;)
+				(*c.f)(i);
+		};
+		job.ctx = &ctx;
+		// only there to give every chunk a non-empty range
+		job.n = static_cast<std::size_t>(chunks) * ALIGN;
+		job.chunks = chunks;
+		run();
+	}
+
+	[[nodiscard]] int chunk_count(std::size_t n, std::size_t min_chunk) const {
+		const std::size_t by_size = n / std::max<std::size_t>(1, min_chunk);
+		return static_cast<int>(std::clamp<std::size_t>(
+		    by_size, 1, static_cast<std::size_t>(size())));
+	}
+
+	static std::size_t chunk_begin(std::size_t n, int chunks, int c) {
+		if (c >= chunks)
+			return n;
+		std::size_t b = n * static_cast<std::size_t>(c) / chunks;
+		return std::min(n, b / ALIGN * ALIGN);
+	}
+
+private:
+	struct Job {
+		void (*fn)(void *, int, std::size_t, std::size_t) = nullptr;
+		void *ctx = nullptr;
+		std::size_t n = 0;
+		int chunks = 0;
+	};
+
+	std::vector<std::thread> workers;
+	Job job;
+	std::atomic<std::uint32_t> generation{0};
+	std::atomic<int> pending{0};
+	std::atomic<bool> quit{false};
+
+	void run_chunk(int c) {
+		const std::size_t b = chunk_begin(job.n, job.chunks, c);
+		const std::size_t e = chunk_begin(job.n, job.chunks, c + 1);
+		if (b < e)
+			job.fn(job.ctx, c, b, e);
+	}
+
+	// every worker acknowledges every generation, even ones with no chunk, so
+	// nobody can still be reading job when the caller writes the next one
+	void run() {
+		pending.store(static_cast<int>(workers.size()),
+		              std::memory_order_relaxed);
+		generation.fetch_add(1, std::memory_order_release);
+		generation.notify_all();
+
+		run_chunk(0);
+
+		// the main browser thread can't block, so spin here instead of wait()
+		while (pending.load(std::memory_order_acquire) != 0)
+			std::this_thread::yield();
+	}
+
+	void worker_loop(int index, std::uint32_t seen) {
+		for (;;) {
+			for (int spin = 0; spin < 2048; ++spin) {
+				if (generation.load(std::memory_order_acquire) != seen)
+					break;
+			}
+			generation.wait(seen, std::memory_order_acquire);
+			seen = generation.load(std::memory_order_acquire);
+			if (quit.load(std::memory_order_relaxed))
+				return;
+
+			if (index < job.chunks)
+				run_chunk(index);
+			pending.fetch_sub(1, std::memory_order_acq_rel);
+		}
+	}
+
+	void stop() {
+		if (workers.empty())
+			return;
+		quit.store(true, std::memory_order_relaxed);
+		generation.fetch_add(1, std::memory_order_release);
+		generation.notify_all();
+		for (auto &t : workers)
+			t.join();
+		workers.clear();
+	}
+};
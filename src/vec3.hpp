@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cmath>
+
+struct Vec3 {
+	float x, y, z;
+	constexpr Vec3 operator+(Vec3 o) const {
+		return {x + o.x, y + o.y, z + o.z};
+	}
+	constexpr Vec3 operator-(Vec3 o) const {
+		return {x - o.x, y - o.y, z - o.z};
+	}
+	constexpr Vec3 operator*(float s) const {
+		return {x * s, y * s, z * s};
+	}
+	[[nodiscard]] constexpr float dot(Vec3 o) const {
+		return x * o.x + y * o.y + z * o.z;
+	}
+	[[nodiscard]] float length() const {
+		return std::sqrt(x * x + y * y + z * z);
+	}
+};
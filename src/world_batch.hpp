@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "cloth_lod.hpp"
+#include "physics_world.hpp"
+
+// per world record of the table behind WorldBatch::get_lod_ptr, in floats:
+// the grid of the level being stepped, whose particles are the first
+// w * h of the world's range in the view, and a bounding sphere of them in
+// render space
+enum LodLayout {
+	LOD_FIRST = 0,  // first particle of the world in the view
+	LOD_W = 1,
+	LOD_H = 2,
+	LOD_LEVEL = 3,
+	LOD_CENTER = 4, // x, y, z
+	LOD_RADIUS = 7,
+	LOD_STRIDE = 8
+};
+
+// many small cloths behind one set of calls. every cloth is its own
+// single threaded PhysicsWorld (parameters, solver, colliders, sleeping), the
+// batch steps them as tasks on its pool, biggest first, and each task
+// exports its world straight into one shared VIEW_STRIDE view. the worlds
+// share fixed_dt and max_steps so they stay on the same frame.
+//
+// every cloth also has coarser levels (see ClothLod) that js switches to by
+// distance. the view keeps room for the finest level of every world, a
+// coarser one only fills the start of its range and the lod table says how
+// to upsample it.
+//
+// world ids are indices in add order and stay valid until clear(). calls
+// that take a world id apply to every world when it is negative
+class WorldBatch {
+	std::vector<std::unique_ptr<ClothLod>> worlds;
+	// world w's particles are [offsets[w], offsets[w + 1]) in the view
+	std::vector<std::uint32_t> offsets{0};
+	// task order, by stepped particle count descending
+	std::vector<int> order;
+	bool order_dirty = false;
+	AlignedVec<float> view;
+	AlignedVec<float> lod;
+	float fixed_dt = 1.0f / 60.0f;
+	int max_steps = 4;
+	ThreadPool pool;
+
+	template <class F> void for_cloths(int id, F &&f) {
+		if (id < 0) {
+			for (auto &w : worlds)
+				f(*w);
+		} else if (id < static_cast<int>(worlds.size())) {
+			f(*worlds[id]);
+		}
+	}
+	// every level of the cloths, parameters stay the same across levels
+	template <class F> void for_worlds(int id, F &&f) {
+		for_cloths(id, [&](ClothLod &c) { c.for_levels(f); });
+	}
+
+	// the last touched world's answer, -1 when the id matched nothing
+	template <class F> auto collider_call(int id, F &&f) -> int {
+		int result = -1;
+		for_worlds(id, [&](PhysicsWorld &w) { result = f(w); });
+		return result;
+	}
+
+	void export_world(int id) {
+		PhysicsWorld &w = worlds[id]->world();
+		float *out = view.data() + offsets[id] * VIEW_STRIDE;
+		w.export_view_to(out);
+
+		Vec3 lo{INFINITY, INFINITY, INFINITY}, hi{-INFINITY, -INFINITY, -INFINITY};
+		const int n = w.get_p_count();
+		for (const float *v = out; v < out + n * VIEW_STRIDE; v += VIEW_STRIDE) {
+			lo = {std::min(lo.x, v[VIEW_X]), std::min(lo.y, v[VIEW_Y]), std::min(lo.z, v[VIEW_Z])};
+			hi = {std::max(hi.x, v[VIEW_X]), std::max(hi.y, v[VIEW_Y]), std::max(hi.z, v[VIEW_Z])};
+		}
+		float *r = lod.data() + std::size_t(id) * LOD_STRIDE;
+		r[LOD_FIRST] = offsets[id];
+		r[LOD_W] = w.get_grid_w();
+		r[LOD_H] = w.get_grid_h();
+		r[LOD_LEVEL] = worlds[id]->get_level();
+		const Vec3 c = n > 0 ? (lo + hi) * 0.5f : Vec3{0, 0, 0};
+		r[LOD_CENTER] = c.x;
+		r[LOD_CENTER + 1] = c.y;
+		r[LOD_CENTER + 2] = c.z;
+		r[LOD_RADIUS] = n > 0 ? (hi - c).length() : 0.0f;
+	}
+	void sort_order() {
+		order.resize(worlds.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+			return worlds[a]->world().get_p_count() > worlds[b]->world().get_p_count();
+		});
+		order_dirty = false;
+	}
+
+public:
+	auto add_cloth(float sx, float sy, float sz, int w, int h, float sep,
+	               float k, float damp) -> int {
+		auto cloth = std::make_unique<ClothLod>();
+		cloth->create_cloth(sx, sy, sz, w, h, sep, k, damp);
+		cloth->for_levels([&](PhysicsWorld &l) {
+			l.set_fixed_dt(fixed_dt);
+			l.set_max_steps(max_steps);
+		});
+		offsets.push_back(offsets.back() + cloth->get_p_count());
+		worlds.push_back(std::move(cloth));
+		sort_order();
+
+		view.resize(offsets.back() * VIEW_STRIDE);
+		lod.resize(worlds.size() * LOD_STRIDE);
+		for (int i = 0; i < static_cast<int>(worlds.size()); ++i)
+			export_world(i);
+		return static_cast<int>(worlds.size()) - 1;
+	}
+	void clear() {
+		worlds.clear();
+		offsets.assign(1, 0);
+		order.clear();
+		view.clear();
+		lod.clear();
+	}
+	auto get_world_count() const -> int {
+		return worlds.size();
+	}
+
+	void update(float frame_dt) {
+		if (order_dirty)
+			sort_order();
+		pool.parallel_tasks(order.size(), [&](std::size_t t) {
+			const int id = order[t];
+			worlds[id]->world().advance(frame_dt);
+			export_world(id);
+		});
+	}
+
+	// the shared view, moves on add_cloth and clear
+	auto get_p_ptr() const -> uintptr_t {
+		return (uintptr_t)view.data();
+	}
+	auto get_p_count() const -> int {
+		return offsets.back();
+	}
+	// LOD_STRIDE floats per world, see LodLayout. refreshed by update, moves
+	// on add_cloth and clear
+	auto get_lod_ptr() const -> uintptr_t {
+		return (uintptr_t)lod.data();
+	}
+	// first particle of world id in the view
+	auto get_world_offset(int id) const -> int {
+		return id >= 0 && id < static_cast<int>(worlds.size()) ? offsets[id] : 0;
+	}
+	auto get_world_p_count(int id) const -> int {
+		return id >= 0 && id < static_cast<int>(worlds.size())
+		           ? offsets[id + 1] - offsets[id]
+		           : 0;
+	}
+	// PhysicsWorld::get_stats_ptr of world id, 0 for a bad id
+	auto get_stats_ptr(int id) const -> uintptr_t {
+		return id >= 0 && id < static_cast<int>(worlds.size())
+		           ? worlds[id]->world().get_stats_ptr()
+		           : 0;
+	}
+	auto get_alpha() const -> float {
+		return worlds.empty() ? 1.0f : worlds.front()->world().get_alpha();
+	}
+
+	// levels of world id, 1 when it has no coarser ones, 0 for a bad id
+	auto get_level_count(int id) const -> int {
+		return id >= 0 && id < static_cast<int>(worlds.size())
+		           ? worlds[id]->get_level_count()
+		           : 0;
+	}
+	auto get_level(int id) const -> int {
+		return id >= 0 && id < static_cast<int>(worlds.size())
+		           ? worlds[id]->get_level()
+		           : 0;
+	}
+	// 0 is the full grid, clamped to the coarsest. the view and the lod table
+	// follow with the next update
+	void set_level(int id, int level) {
+		for_cloths(id, [&](ClothLod &c) {
+			if (c.get_level() == std::clamp(level, 0, c.get_level_count() - 1))
+				return;
+			c.set_level(level);
+			order_dirty = true;
+		});
+	}
+
+	void set_fixed_dt(float dt) {
+		fixed_dt = std::max(1e-4f, dt);
+		for_worlds(-1, [&](PhysicsWorld &w) { w.set_fixed_dt(fixed_dt); });
+	}
+	void set_max_steps(int n) {
+		max_steps = std::max(1, n);
+		for_worlds(-1, [&](PhysicsWorld &w) { w.set_max_steps(max_steps); });
+	}
+	// threads across worlds, every world itself stays on one
+	void set_thread_count(int n) {
+		pool.resize(n);
+	}
+	auto get_thread_count() const -> int {
+		return pool.size();
+	}
+
+	// per world parameters
+	void set_gravity(int id, float x, float y, float z) {
+		for_worlds(id, [&](PhysicsWorld &w) { w.set_gravity(x, y, z); });
+	}
+	void set_wind(int id, float x, float y, float z) {
+		for_worlds(id, [&](PhysicsWorld &w) { w.set_wind(x, y, z); });
+	}
+	void set_damping(int id, float d) {
+		for_worlds(id, [&](PhysicsWorld &w) { w.set_damping(d); });
+	}
+	void set_solver(int id, int type) {
+		for_worlds(id, [&](PhysicsWorld &w) { w.set_solver(type); });
+	}
+	void set_sub_steps(int id, int steps) {
+		for_worlds(id, [&](PhysicsWorld &w) { w.set_sub_steps(steps); });
+	}
+	void set_spring_params(int id, float k, float damp) {
+		for_worlds(id, [&](PhysicsWorld &w) { w.set_spring_params(k, damp); });
+	}
+	// per particle of the full grid, the coarser levels scale it up
+	void set_mass(int id, float m) {
+		for_cloths(id, [&](ClothLod &c) { c.set_mass(m); });
+	}
+	void set_sleep_threshold(int id, float energy, int steps) {
+		for_worlds(id, [&](PhysicsWorld &w) { w.set_sleep_threshold(energy, steps); });
+	}
+	// i is the particle index inside the full grid of the world, not in the
+	// view. coarser levels take it at their nearest particle
+	void set_pinned(int id, int i, bool pin) {
+		for_cloths(id, [&](ClothLod &c) { c.set_pinned(i, pin); });
+	}
+	void set_particle_pos(int id, int i, float x, float y, float z) {
+		for_cloths(id, [&](ClothLod &c) { c.set_particle_pos(i, x, y, z); });
+	}
+
+	// colliders live in each world, a negative id adds the same one to all of
+	// them (same collider id too while they were all built the same way)
+	auto add_sphere(int id, float x, float y, float z, float r) -> int {
+		return collider_call(
+		    id, [&](PhysicsWorld &w) { return w.add_sphere(x, y, z, r); });
+	}
+	auto add_capsule(int id, float ax, float ay, float az, float bx, float by,
+	                 float bz, float r) -> int {
+		return collider_call(id, [&](PhysicsWorld &w) {
+			return w.add_capsule(ax, ay, az, bx, by, bz, r);
+		});
+	}
+	auto add_plane(int id, float nx, float ny, float nz, float offset) -> int {
+		return collider_call(
+		    id, [&](PhysicsWorld &w) { return w.add_plane(nx, ny, nz, offset); });
+	}
+	void set_collider_pos(int id, int collider, float x, float y, float z) {
+		for_worlds(id, [&](PhysicsWorld &w) { w.set_collider_pos(collider, x, y, z); });
+	}
+	void clear_colliders(int id) {
+		for_worlds(id, [&](PhysicsWorld &w) { w.clear_colliders(); });
+	}
+};